@@ -0,0 +1,637 @@
+#pragma once
+
+#include "automaton.h"
+#include "ltl.h"
+#include "translator.h"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Translates LTL formulas into Büchi automata through very weak alternating
+/// automata, after Gastin and Oddoux. The formula is put in negation normal
+/// form, every temporal subformula becomes a state of the alternating
+/// automaton and the generalized Büchi automaton is built over the sets of
+/// them reachable from the initial ones, with one acceptance condition per
+/// until on its transitions. Moves implied by a weaker sibling are dropped on
+/// the fly at both levels.
+///
+/// The result is an Automaton like the one of Translator: a state stands for
+/// a transition of the generalized automaton, is labelled with the literals
+/// the letter it reads must satisfy (see label()) and is accepting for the
+/// conditions of that transition.
+class AlternatingTranslator
+{
+public:
+    /// Sorted literals, `2 * atom` for an atom and `2 * atom + 1` for its
+    /// negation; empty for true
+    using Cube = std::vector<int>;
+
+    explicit AlternatingTranslator(Budget budget = Budget()) : budget(budget) { }
+
+    AlternatingTranslator(const AlternatingTranslator &) = delete;
+    AlternatingTranslator &operator=(const AlternatingTranslator &) = delete;
+
+    /// Returns an empty pointer if the budget is exceeded, see budget_status()
+    std::unique_ptr<Automaton> translate(const ref_ptr<Ltl> &formula)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+        clear();
+
+        int root = normalize(formula.get());
+        build_moves(root);
+
+        for (int node = 0; node < (int) nodes.size(); node++)
+        {
+            if (needed[node] && nodes[node].kind == Operator::U)
+                untils.push_back(node);
+        }
+
+        std::vector<int> initial;
+        for (const std::vector<int> &set : bar[root])
+            initial.push_back(set_state_of(set));
+
+        while (!pending.empty())
+        {
+            int set_state = pending.front();
+            pending.pop_front();
+            expand(set_state);
+
+            if (exceeds_budget(0))
+                return nullptr;
+        }
+
+        std::unique_ptr<Automaton> maton(new Automaton(edge_states.size()));
+        maton->reserve_accept_sets(untils.size());
+
+        for (int set_state : initial)
+        {
+            for (size_t state : out[set_state])
+                maton->mark_init(state);
+        }
+
+        size_t edges = 0;
+        for (size_t state = 0; state < edge_states.size(); state++)
+        {
+            const EdgeState &edge = edge_states[state];
+            for (size_t to : out[edge.target])
+                maton->add_transition(state, to);
+            edges += out[edge.target].size();
+
+            for (int set : edge.marks)
+                maton->mark_accept(set, state);
+
+            maton->set_label(state, label_text(state));
+        }
+
+        if (exceeds_budget(edges))
+            return nullptr;
+
+        return maton;
+    }
+
+    const BudgetStatus &budget_status() const
+    {
+        return status;
+    }
+
+    /// Nodes of the normal form the last automaton was built from, the
+    /// states of its alternating automaton among them
+    size_t alternating_size() const
+    {
+        return std::count(needed.begin(), needed.end(), true);
+    }
+
+    /// Literals the letter read in `state` of the last automaton satisfies
+    const Cube &label(size_t state) const
+    {
+        return edge_states[state].label;
+    }
+
+    /// Class of the label of every state of the last automaton, the states
+    /// of one class read the same letters
+    std::vector<size_t> state_letters() const
+    {
+        std::map<Cube, size_t> classes;
+        std::vector<size_t> letters;
+        for (const EdgeState &state : edge_states)
+            letters.push_back(classes.emplace(state.label, classes.size()).first->second);
+        return letters;
+    }
+
+    /// Names of the atoms the literals of label() refer to
+    const std::vector<std::string> &atom_names() const
+    {
+        return names;
+    }
+
+    /// label() as a conjunction, such as `p & !q`
+    std::string label_text(size_t state) const
+    {
+        return text_of(label(state), names);
+    }
+
+    /// `cube` as a conjunction of the atoms of `names`
+    static std::string text_of(const Cube &cube, const std::vector<std::string> &names)
+    {
+        if (cube.empty())
+            return "true";
+
+        std::string text;
+        for (int literal : cube)
+        {
+            if (!text.empty())
+                text += " & ";
+            if (literal & 1)
+                text += "!";
+            text += names[literal / 2];
+        }
+        return text;
+    }
+
+    /// Puts the literals of `a` and `b` in `result`, returns false if they
+    /// contradict each other
+    static bool conjoin(const Cube &a, const Cube &b, Cube &result)
+    {
+        result.clear();
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+        for (size_t i = 1; i < result.size(); i++)
+        {
+            if ((result[i] ^ result[i - 1]) == 1)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    /// Node of the formula in negation normal form over TRUE, FALSE, ATOM
+    /// literals, AND, OR, X, U and R; equal nodes share their index
+    struct Node
+    {
+        Operator kind;
+        int lhs;
+        int rhs;
+        int literal;        // ATOM nodes only
+    };
+
+    /// One choice of a transition: the letters it reads and the conjunction
+    /// of nodes it moves to
+    struct Move
+    {
+        Cube label;
+        std::vector<int> next;
+        std::vector<int> marks;     // acceptance conditions, moves of set states only
+
+        bool operator<(const Move &other) const
+        {
+            return std::tie(label, next, marks) < std::tie(other.label, other.next, other.marks);
+        }
+
+        bool operator==(const Move &other) const
+        {
+            return label == other.label && next == other.next && marks == other.marks;
+        }
+    };
+
+    using Moves = std::vector<Move>;
+
+    /// State of the result, a transition of the generalized automaton into
+    /// the set state `target`
+    struct EdgeState
+    {
+        int target;
+        Cube label;
+        std::vector<int> marks;
+    };
+
+    static constexpr int TRUE_NODE = 0;
+    static constexpr int FALSE_NODE = 1;
+
+    void clear()
+    {
+        nodes.clear();
+        node_ids.clear();
+        names.clear();
+        atom_ids.clear();
+        delta.clear();
+        bar.clear();
+        needed.clear();
+        untils.clear();
+        set_ids.clear();
+        sets.clear();
+        out.clear();
+        pending.clear();
+        edge_states.clear();
+        edge_ids.clear();
+
+        intern({Operator::TRUE, -1, -1, -1});
+        intern({Operator::FALSE, -1, -1, -1});
+    }
+
+    int intern(const Node &node)
+    {
+        auto key = std::make_tuple(node.kind, node.lhs, node.rhs, node.literal);
+        auto it = node_ids.find(key);
+        if (it != node_ids.end())
+            return it->second;
+
+        nodes.push_back(node);
+        node_ids.emplace(key, nodes.size() - 1);
+        return nodes.size() - 1;
+    }
+
+    int literal(const Ltl *atom, bool negated)
+    {
+        auto it = atom_ids.find(atom->node_to_string());
+        if (it == atom_ids.end())
+        {
+            it = atom_ids.emplace(atom->node_to_string(), names.size()).first;
+            names.push_back(atom->node_to_string());
+        }
+
+        return intern({Operator::ATOM, -1, -1, 2 * it->second + negated});
+    }
+
+    /// Builds a node of the normal form, simplified by the constants and the
+    /// idempotence of AND and OR
+    int make(Operator kind, int lhs, int rhs = -1)
+    {
+        switch (kind)
+        {
+            case Operator::AND:
+                if (lhs == FALSE_NODE || rhs == FALSE_NODE)
+                    return FALSE_NODE;
+                if (lhs == TRUE_NODE || lhs == rhs)
+                    return rhs;
+                if (rhs == TRUE_NODE)
+                    return lhs;
+                break;
+
+            case Operator::OR:
+                if (lhs == TRUE_NODE || rhs == TRUE_NODE)
+                    return TRUE_NODE;
+                if (lhs == FALSE_NODE || lhs == rhs)
+                    return rhs;
+                if (rhs == FALSE_NODE)
+                    return lhs;
+                break;
+
+            case Operator::X:
+                if (lhs == TRUE_NODE || lhs == FALSE_NODE)
+                    return lhs;
+                break;
+
+            case Operator::U:
+                if (rhs == TRUE_NODE || rhs == FALSE_NODE || lhs == FALSE_NODE)
+                    return rhs;
+                break;
+
+            case Operator::R:
+                if (rhs == TRUE_NODE || rhs == FALSE_NODE || lhs == TRUE_NODE)
+                    return rhs;
+                break;
+
+            default:
+                break;
+        }
+
+        if ((kind == Operator::AND || kind == Operator::OR) && rhs < lhs)
+            std::swap(lhs, rhs);
+
+        return intern({kind, lhs, rhs, -1});
+    }
+
+    /// Index of `ltl` in negation normal form. Both polarities of every
+    /// subformula are built bottom-up, so no traversal recurses.
+    int normalize(const Ltl *ltl)
+    {
+        std::unordered_map<const Ltl*, std::pair<int, int>> polarities;
+
+        Ltl::for_each_postorder(ltl, [&](const Ltl *node)
+        {
+            int pl = -1, nl = -1, pr = -1, nr = -1;
+            if (node->lhs())
+                std::tie(pl, nl) = polarities[node->lhs()];
+            if (node->rhs())
+                std::tie(pr, nr) = polarities[node->rhs()];
+
+            std::pair<int, int> result;
+            switch (node->kind())
+            {
+                case Operator::TRUE: result = {TRUE_NODE, FALSE_NODE}; break;
+                case Operator::FALSE: result = {FALSE_NODE, TRUE_NODE}; break;
+                case Operator::ATOM: result = {literal(node, false), literal(node, true)}; break;
+                case Operator::NOT: result = {nl, pl}; break;
+                case Operator::X: result = {make(Operator::X, pl), make(Operator::X, nl)}; break;
+                case Operator::F: result = {make(Operator::U, TRUE_NODE, pl), make(Operator::R, FALSE_NODE, nl)}; break;
+                case Operator::G: result = {make(Operator::R, FALSE_NODE, pl), make(Operator::U, TRUE_NODE, nl)}; break;
+                case Operator::AND: result = {make(Operator::AND, pl, pr), make(Operator::OR, nl, nr)}; break;
+                case Operator::OR: result = {make(Operator::OR, pl, pr), make(Operator::AND, nl, nr)}; break;
+                case Operator::IMPL: result = {make(Operator::OR, nl, pr), make(Operator::AND, pl, nr)}; break;
+                case Operator::U: result = {make(Operator::U, pl, pr), make(Operator::R, nl, nr)}; break;
+                case Operator::R: result = {make(Operator::R, pl, pr), make(Operator::U, nl, nr)}; break;
+
+                // a W b = b R (a | b)
+                case Operator::W: result = {make(Operator::R, pr, make(Operator::OR, pl, pr)),
+                                            make(Operator::U, nr, make(Operator::AND, nl, nr))}; break;
+
+                default: result = {FALSE_NODE, TRUE_NODE}; break;
+            }
+
+            polarities[node] = result;
+        });
+
+        return polarities[ltl].first;
+    }
+
+    /// Every letter `a` reads is read by `b`
+    static bool implies(const Cube &a, const Cube &b)
+    {
+        return std::includes(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    /// `a` is not needed next to `b`: it reads fewer letters, moves to more
+    /// nodes and satisfies fewer conditions
+    static bool dominated(const Move &a, const Move &b)
+    {
+        return implies(a.label, b.label) &&
+               std::includes(a.next.begin(), a.next.end(), b.next.begin(), b.next.end()) &&
+               std::includes(b.marks.begin(), b.marks.end(), a.marks.begin(), a.marks.end());
+    }
+
+    static void simplify(Moves &moves)
+    {
+        std::sort(moves.begin(), moves.end());
+        moves.erase(std::unique(moves.begin(), moves.end()), moves.end());
+
+        std::vector<bool> redundant(moves.size(), false);
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            for (size_t j = 0; j < moves.size() && !redundant[i]; j++)
+                redundant[i] = j != i && dominated(moves[i], moves[j]);
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            if (redundant[i])
+                continue;
+            if (kept != i)
+                moves[kept] = std::move(moves[i]);
+            kept++;
+        }
+        moves.resize(kept);
+    }
+
+    /// Every pair of moves of `a` and `b` together; moves dominated by
+    /// another are only dropped with `prune`, the acceptance conditions of
+    /// the product may still tell them apart otherwise
+    static Moves product(const Moves &a, const Moves &b, bool prune = true)
+    {
+        Moves result;
+        Move move;
+        for (const Move &x : a)
+        {
+            for (const Move &y : b)
+            {
+                if (!conjoin(x.label, y.label, move.label))
+                    continue;
+
+                move.next.clear();
+                std::set_union(x.next.begin(), x.next.end(), y.next.begin(), y.next.end(), std::back_inserter(move.next));
+                result.push_back(move);
+            }
+        }
+
+        if (prune)
+        {
+            simplify(result);
+        }
+        else
+        {
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+        }
+        return result;
+    }
+
+    static Moves sum(Moves a, const Moves &b)
+    {
+        a.insert(a.end(), b.begin(), b.end());
+        simplify(a);
+        return a;
+    }
+
+    /// Disjunctive normal form of a node over the other nodes, the sets of
+    /// nodes one of which must hold
+    static std::vector<std::vector<int>> bar_product(const std::vector<std::vector<int>> &a, const std::vector<std::vector<int>> &b)
+    {
+        std::vector<std::vector<int>> result;
+        for (const std::vector<int> &x : a)
+        {
+            for (const std::vector<int> &y : b)
+            {
+                std::vector<int> set;
+                std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(set));
+                result.push_back(std::move(set));
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    /// Transitions and normal forms of every node `root` depends on. Nodes are
+    /// interned after their operands, so one pass in index order sees the
+    /// operands of a node first.
+    void build_moves(int root)
+    {
+        needed.assign(nodes.size(), false);
+        needed[root] = true;
+        for (int node = root; node >= 0; node--)
+        {
+            if (!needed[node])
+                continue;
+            if (nodes[node].lhs >= 0)
+                needed[nodes[node].lhs] = true;
+            if (nodes[node].rhs >= 0)
+                needed[nodes[node].rhs] = true;
+        }
+
+        delta.assign(nodes.size(), Moves());
+        bar.assign(nodes.size(), {});
+
+        for (int node = 0; node <= root; node++)
+        {
+            if (!needed[node])
+                continue;
+
+            const Node &n = nodes[node];
+            Moves self = {{Cube(), {node}, {}}};
+
+            switch (n.kind)
+            {
+                case Operator::TRUE:
+                    delta[node] = {{Cube(), {}, {}}};
+                    bar[node] = {{}};
+                    break;
+
+                case Operator::FALSE:
+                    break;
+
+                case Operator::ATOM:
+                    delta[node] = {{{n.literal}, {}, {}}};
+                    bar[node] = {{node}};
+                    break;
+
+                case Operator::AND:
+                    delta[node] = product(delta[n.lhs], delta[n.rhs]);
+                    bar[node] = bar_product(bar[n.lhs], bar[n.rhs]);
+                    break;
+
+                case Operator::OR:
+                    delta[node] = sum(delta[n.lhs], delta[n.rhs]);
+                    bar[node] = bar[n.lhs];
+                    bar[node].insert(bar[node].end(), bar[n.rhs].begin(), bar[n.rhs].end());
+                    break;
+
+                case Operator::X:
+                    for (const std::vector<int> &set : bar[n.lhs])
+                        delta[node].push_back({Cube(), set, {}});
+                    simplify(delta[node]);
+                    bar[node] = {{node}};
+                    break;
+
+                case Operator::U:
+                    delta[node] = sum(delta[n.rhs], product(delta[n.lhs], self));
+                    bar[node] = {{node}};
+                    break;
+
+                case Operator::R:
+                    delta[node] = product(delta[n.rhs], sum(delta[n.lhs], self));
+                    bar[node] = {{node}};
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    /// Index of the state of the generalized automaton for the set of
+    /// nodes `set`, queued for expansion when it is new
+    int set_state_of(const std::vector<int> &set)
+    {
+        auto it = set_ids.find(set);
+        if (it != set_ids.end())
+            return it->second;
+
+        int id = sets.size();
+        set_ids.emplace(set, id);
+        sets.push_back(set);
+        out.emplace_back();
+        pending.push_back(id);
+        return id;
+    }
+
+    size_t edge_state_of(int target, const Cube &label, const std::vector<int> &marks)
+    {
+        auto key = std::make_tuple(target, label, marks);
+        auto it = edge_ids.find(key);
+        if (it != edge_ids.end())
+            return it->second;
+
+        edge_states.push_back({target, label, marks});
+        edge_ids.emplace(std::move(key), edge_states.size() - 1);
+        return edge_states.size() - 1;
+    }
+
+    /// Finds the moves of a set state, the product of the moves of its
+    /// nodes, with the conditions of the untils each of them satisfies
+    void expand(int set_state)
+    {
+        Moves moves = {{Cube(), {}, {}}};
+        for (int node : sets[set_state])
+            moves = product(moves, delta[node], false);
+
+        for (Move &move : moves)
+        {
+            for (size_t set = 0; set < untils.size(); set++)
+            {
+                if (satisfies(move, untils[set]))
+                    move.marks.push_back(set);
+            }
+        }
+        simplify(moves);
+
+        std::vector<size_t> targets;
+        for (const Move &move : moves)
+        {
+            int target = set_state_of(move.next);
+            targets.push_back(edge_state_of(target, move.label, move.marks));
+        }
+        out[set_state] = std::move(targets);
+    }
+
+    /// A move satisfies the condition of `until` if it leaves it behind, or
+    /// if one of its own moves which does so is implied by it
+    bool satisfies(const Move &move, int until) const
+    {
+        if (!std::binary_search(move.next.begin(), move.next.end(), until))
+            return true;
+
+        for (const Move &own : delta[until])
+        {
+            if (!std::binary_search(own.next.begin(), own.next.end(), until) && implies(move.label, own.label) &&
+                std::includes(move.next.begin(), move.next.end(), own.next.begin(), own.next.end()))
+                return true;
+        }
+
+        return false;
+    }
+
+    /// Updates the progress in `status` and marks the limit that is reached
+    /// first, as Translator does
+    bool exceeds_budget(size_t edges)
+    {
+        status.states = edge_states.size();
+        status.edges = edges;
+        status.bytes = edge_states.size() * (sizeof(EdgeState) + sizeof(std::vector<size_t>)) + edges * sizeof(size_t);
+        status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return budget.exceeded_by(status);
+    }
+
+    Budget budget;
+    BudgetStatus status;
+    std::chrono::steady_clock::time_point start;
+
+    std::vector<Node> nodes;
+    std::map<std::tuple<Operator, int, int, int>, int> node_ids;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> atom_ids;
+
+    std::vector<Moves> delta;                           // transitions of the alternating automaton by node
+    std::vector<std::vector<std::vector<int>>> bar;     // normal forms by node
+    std::vector<bool> needed;
+    std::vector<int> untils;                            // the node of every acceptance condition
+
+    std::map<std::vector<int>, int> set_ids;
+    std::vector<std::vector<int>> sets;
+    std::vector<std::vector<size_t>> out;               // edge states of the moves of every set state
+    std::deque<int> pending;
+
+    std::vector<EdgeState> edge_states;
+    std::map<std::tuple<int, Cube, std::vector<int>>, size_t> edge_ids;
+};
@@ -0,0 +1,672 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Appends `value` in groups of 7 bits, the lowest first, with the high bit
+/// set on every byte but the last
+inline void write_varint(std::vector<uint8_t> &bytes, size_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(uint8_t(value));
+}
+
+inline size_t read_varint(const uint8_t *&bytes)
+{
+    size_t value = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        uint8_t byte = *bytes++;
+        value |= size_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+/// Successors of one state in increasing order, read from a plain row or
+/// decoded on the fly from a compressed one
+class Successors
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const size_t*;
+        using reference = size_t;
+
+        iterator(const size_t *plain, const uint8_t *bytes, size_t remaining)
+            : plain(plain), bytes(bytes), remaining(remaining)
+        {
+            if (!plain && remaining)
+                value = read_varint(this->bytes);
+        }
+
+        size_t operator*() const
+        {
+            return plain ? *plain : value;
+        }
+
+        iterator &operator++()
+        {
+            if (plain)
+                plain++;
+            else if (remaining > 1)
+                value += read_varint(bytes);
+            remaining--;
+            return *this;
+        }
+
+        /// Only iterators of the same row are compared
+        bool operator==(const iterator &other) const
+        {
+            return remaining == other.remaining;
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return remaining != other.remaining;
+        }
+
+    private:
+        const size_t *plain;        // null in a compressed row
+        const uint8_t *bytes;
+        size_t remaining;
+        size_t value = 0;
+    };
+
+    Successors(const size_t *plain, const uint8_t *bytes, size_t count) : plain(plain), bytes(bytes), count(count) { }
+
+    /// Successors in a vector, which must outlive them
+    explicit Successors(const std::vector<size_t> &values) : Successors(values.data(), nullptr, values.size()) { }
+
+    iterator begin() const
+    {
+        return iterator(plain, bytes, count);
+    }
+
+    iterator end() const
+    {
+        return iterator(plain, bytes, 0);
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return !count;
+    }
+
+private:
+    const size_t *plain;
+    const uint8_t *bytes;
+    size_t count;
+};
+
+/// Appends the count, the first value and the gaps of sorted `values`, the
+/// encoding of a compressed row
+inline void write_row(std::vector<uint8_t> &bytes, const Successors &values)
+{
+    write_varint(bytes, values.size());
+
+    size_t previous = 0;
+    for (size_t value : values)
+    {
+        write_varint(bytes, value - previous);
+        previous = value;
+    }
+}
+
+/// Writes an automaton in the binary format, section by section and in
+/// this order, with every set encoded like a compressed row:
+///
+///     "GBA1" states sets flags
+///     initial states, then every accepting set
+///     rows, then every row, then the row of every state
+///     with flag LABELLED: the length and the bytes of every label
+///
+/// where every number is a varint. Rows are written out one by one, so an
+/// automaton which is not held in memory can be written too.
+class GbaWriter
+{
+public:
+    static constexpr size_t STUTTER_INVARIANT = 1;
+    static constexpr size_t LABELLED = 2;
+
+    explicit GbaWriter(FILE *f) : f(f) { }
+
+    void write_header(size_t states, size_t sets, size_t flags)
+    {
+        bytes.insert(bytes.end(), {'G', 'B', 'A', '1'});
+        write_varint(bytes, states);
+        write_varint(bytes, sets);
+        write_varint(bytes, flags);
+    }
+
+    /// The initial states or an accepting set, sorted
+    void write_set(const Successors &states)
+    {
+        write_row(bytes, states);
+    }
+
+    void write_row_count(size_t rows)
+    {
+        write_varint(bytes, rows);
+    }
+
+    /// Successors of one row, sorted; flushed at once so the buffer stays small
+    void write_successors(const Successors &successors)
+    {
+        write_row(bytes, successors);
+        flush();
+    }
+
+    void write_row_of_state(size_t row)
+    {
+        write_varint(bytes, row);
+    }
+
+    void write_label(const std::string &label)
+    {
+        write_varint(bytes, label.size());
+        bytes.insert(bytes.end(), label.begin(), label.end());
+    }
+
+    void flush()
+    {
+        fwrite(bytes.data(), 1, bytes.size(), f);
+        bytes.clear();
+    }
+
+private:
+    FILE *f;
+    std::vector<uint8_t> bytes;
+};
+
+class Automaton
+{
+    using index_vec_type = std::vector<size_t>;
+
+    static constexpr size_t PLAIN = SIZE_MAX;
+
+    // Successor sets are stored as rows which states with equal successors
+    // share; a shared row is copied before it is changed. A compressed row
+    // lives in `packed` from `packed_at` on: its length, its first successor
+    // and the gaps to the next ones, all as varints.
+    std::vector<index_vec_type> rows;
+    std::vector<size_t> packed_at;
+    std::vector<uint8_t> packed;
+    std::vector<size_t> row_of;
+    std::vector<size_t> row_users;
+    std::vector<index_vec_type> accepting;
+    index_vec_type initial;
+    std::vector<std::string> labels;
+    bool stutter_invariant = false;
+
+public:
+    Automaton(const Automaton &) = delete;
+    Automaton &operator=(const Automaton &) = delete;
+
+    /// Init automaton for a given number of states
+    Automaton(size_t card)
+    {
+        rows.resize(card);
+        packed_at.assign(card, PLAIN);
+        row_of.resize(card);
+        row_users.assign(card, 1);
+        for (size_t state = 0; state < card; state++)
+            row_of[state] = state;
+    }
+
+    /// A compressed row is decoded first
+    void add_transition(size_t src, size_t dst)
+    {
+        size_t &row = row_of[src];
+        if (row_users[row] > 1)
+        {
+            row_users[row]--;
+            rows.push_back(plain_row(row));
+            packed_at.push_back(PLAIN);
+            row_users.push_back(1);
+            row = rows.size() - 1;
+        }
+        else if (packed_at[row] != PLAIN)
+        {
+            rows[row] = plain_row(row);
+            packed_at[row] = PLAIN;
+        }
+        rows[row].push_back(dst);
+    }
+
+    /// Gives `state` the successors of `other` by sharing its row; the
+    /// previous successors of `state` are dropped
+    void share_successors(size_t state, size_t other)
+    {
+        assert(state < card() && other < card() && "invalid state number");
+        size_t row = row_of[other];
+        if (row_of[state] == row)
+            return;
+
+        if (--row_users[row_of[state]] == 0)
+            index_vec_type().swap(rows[row_of[state]]);
+
+        row_of[state] = row;
+        row_users[row]++;
+    }
+
+    void mark_init(size_t state)
+    {
+        assert(state < card() && "invalid state number");
+        initial.push_back(state);
+    }
+
+    void mark_accept(size_t set, size_t state)
+    {
+        assert(state < card() && "invalid state number");
+        if (set >= accepting.size())
+        {
+            accepting.resize(set + 1);
+        }
+        accepting[set].push_back(state);
+    }
+
+    /// Declares `count` accepting sets even if some of them stay empty
+    void reserve_accept_sets(size_t count)
+    {
+        if (count > accepting.size())
+        {
+            accepting.resize(count);
+        }
+    }
+
+    /// Text shown next to the state by write_graph_to
+    void set_label(size_t state, std::string label)
+    {
+        assert(state < card() && "invalid state number");
+        labels.resize(card());
+        labels[state] = std::move(label);
+    }
+
+    /// Tells the consumer that the language does not change under stuttering,
+    /// so partial-order reduction may be used against the automaton
+    void mark_stutter_invariant()
+    {
+        stutter_invariant = true;
+    }
+
+    bool is_stutter_invariant() const
+    {
+        return stutter_invariant;
+    }
+
+    Successors successors(size_t state) const
+    {
+        return successors_of_row(row_of[state]);
+    }
+
+    /// Stores the successors of `state` compressed, sorted and without
+    /// duplicates; the row is decoded again by a later add_transition
+    void compress_successors(size_t state)
+    {
+        size_t row = row_of[state];
+        if (packed_at[row] != PLAIN)
+            return;
+
+        deduplicate(rows[row]);
+        packed_at[row] = packed.size();
+        write_row(packed, Successors(rows[row]));
+        index_vec_type().swap(rows[row]);
+    }
+
+    /// Compresses the successors of every state
+    void compress()
+    {
+        for (size_t state = 0; state < card(); state++)
+            compress_successors(state);
+    }
+
+    /// Memory taken by the successors of `state`, in bytes
+    size_t successors_bytes(size_t state) const
+    {
+        size_t row = row_of[state];
+        if (packed_at[row] == PLAIN)
+            return rows[row].size() * sizeof(size_t);
+
+        const uint8_t *bytes = packed.data() + packed_at[row];
+        const uint8_t *end = bytes;
+        size_t count = read_varint(end);
+        for (size_t i = 0; i < count; i++)
+            read_varint(end);
+        return end - bytes;
+    }
+
+    const index_vec_type &initial_states() const
+    {
+        return initial;
+    }
+
+    size_t accept_sets_count() const
+    {
+        return accepting.size();
+    }
+
+    const index_vec_type &accepting_set(size_t set) const
+    {
+        return accepting[set];
+    }
+
+    /// Empty if the state has no label
+    std::string label(size_t state) const
+    {
+        return state < labels.size() ? labels[state] : std::string();
+    }
+
+    void finalize()
+    {
+        // compressed rows are already sorted and without duplicates
+        for (size_t row = 0; row < rows.size(); row++)
+        {
+            if (packed_at[row] == PLAIN)
+                deduplicate(rows[row]);
+        }
+        for (index_vec_type &values : accepting)
+        {
+            deduplicate(values);
+        }
+        deduplicate(initial);
+    }
+
+    void write_to(FILE *f) const
+    {
+        fprintf(f, "%zu %zu\n", card(), accepting.size());
+        write_set_to(f, initial);
+        for (const index_vec_type &accepting_set : accepting)
+        {
+            write_set_to(f, accepting_set);
+        }
+
+        for (size_t state = 0; state < card(); state++)
+        {
+            write_set_to(f, successors(state));
+        }
+    }
+
+    /// Writes the automaton in the binary format of GbaWriter; shared rows
+    /// are written once
+    void write_binary_to(FILE *f) const
+    {
+        GbaWriter writer(f);
+        writer.write_header(card(), accepting.size(),
+                            (stutter_invariant ? GbaWriter::STUTTER_INVARIANT : 0) | (labels.empty() ? 0 : GbaWriter::LABELLED));
+
+        writer.write_set(sorted(initial));
+        for (const index_vec_type &accepting_set : accepting)
+            writer.write_set(sorted(accepting_set));
+
+        std::vector<size_t> written(rows.size(), PLAIN);
+        std::vector<size_t> order;
+        for (size_t row : row_of)
+        {
+            if (written[row] == PLAIN)
+            {
+                written[row] = order.size();
+                order.push_back(row);
+            }
+        }
+
+        writer.write_row_count(order.size());
+        for (size_t row : order)
+            writer.write_successors(successors_of_row(row));
+
+        for (size_t row : row_of)
+            writer.write_row_of_state(written[row]);
+
+        for (const std::string &label : labels)
+            writer.write_label(label);
+
+        writer.flush();
+    }
+
+    /// Reads an automaton written by write_binary_to, keeping its rows
+    /// compressed. Returns an empty pointer if `f` does not hold one.
+    static std::unique_ptr<Automaton> read_binary_from(FILE *f)
+    {
+        char magic[4];
+        size_t card, sets, flags;
+        if (fread(magic, 1, 4, f) != 4 || std::string(magic, 4) != "GBA1" ||
+            !read_varint_from(f, card) || !read_varint_from(f, sets) || !read_varint_from(f, flags))
+            return nullptr;
+
+        std::unique_ptr<Automaton> maton(new Automaton(card));
+        maton->stutter_invariant = flags & GbaWriter::STUTTER_INVARIANT;
+        maton->accepting.resize(sets);
+
+        std::vector<uint8_t> bytes;
+        if (!read_row(f, card, bytes))
+            return nullptr;
+        maton->initial = decode(bytes);
+
+        for (index_vec_type &accepting_set : maton->accepting)
+        {
+            if (!read_row(f, card, bytes))
+                return nullptr;
+            accepting_set = decode(bytes);
+        }
+
+        size_t row_count;
+        if (!read_varint_from(f, row_count))
+            return nullptr;
+
+        maton->rows.assign(row_count, index_vec_type());
+        maton->packed_at.assign(row_count, PLAIN);
+        maton->row_users.assign(row_count, 0);
+        for (size_t row = 0; row < row_count; row++)
+        {
+            maton->packed_at[row] = maton->packed.size();
+            if (!read_row(f, card, maton->packed))
+                return nullptr;
+        }
+
+        for (size_t &row : maton->row_of)
+        {
+            if (!read_varint_from(f, row) || row >= row_count)
+                return nullptr;
+            maton->row_users[row]++;
+        }
+
+        if (flags & GbaWriter::LABELLED)
+        {
+            maton->labels.resize(card);
+            for (std::string &label : maton->labels)
+            {
+                size_t length;
+                if (!read_varint_from(f, length))
+                    return nullptr;
+
+                label.resize(length);
+                if (length && fread(&label[0], 1, length, f) != length)
+                    return nullptr;
+            }
+        }
+
+        return maton;
+    }
+
+    void write_graph_to(FILE* f) const
+    {
+        fprintf(f, "digraph G {\n\tgraph[dpi = 400];\n\tlayout=\"circo\";\n\trankdir=TB;\n");
+        if (stutter_invariant)
+            fprintf(f, "\tcomment=\"stutter-invariant\";\n");
+        
+        // Creating dummy nodes for initial states
+        for (int i = 0; i < initial.size(); i++)
+            fprintf(f, "\tn%d[label=\"\",shape=none,height=.0,width=.0]\n", i);
+
+        fprintf(f, "\n");
+
+        // Creating state nodes
+        for (int i = 0; i < card(); i++)
+        {
+            fprintf(f, "\ts%d[shape=\"circle\"", i + 1);
+
+            bool is_accepting = false;
+            for (auto ac_vec : accepting)
+            {
+                for (auto ac : ac_vec)
+                {
+                    if (ac == i)
+                        is_accepting = true;
+                }
+            }
+
+            if (is_accepting)
+                fprintf(f, ", peripheries=2");
+            if (i < labels.size() && !labels[i].empty())
+                fprintf(f, ", xlabel=\"%s\"", labels[i].c_str());
+            fprintf(f, "]\n");
+        }
+
+        fprintf(f, "\n");
+
+        // Adding edges from nowhere to initial nodes
+        for (int i = 0; i < initial.size(); i++)
+            fprintf(f, "\tn%d->s%d\n", i, initial[i] + 1);
+
+        fprintf(f, "\n");
+
+        // Adding edges between nodes
+        for (int i = 0; i < card(); i++)
+        {
+            for (auto j : successors(i))
+            {
+                fprintf(f, "\ts%d->s%d\n", i+1, j+1);
+            }
+        }
+
+        fprintf(f, "}\n");
+    }
+
+    size_t card() const
+    {
+        return row_of.size();
+    }
+
+    size_t edges() const
+    {
+        size_t count = 0;
+        for (size_t state = 0; state < card(); state++)
+        {
+            count += successors(state).size();
+        }
+        return count;
+    }
+
+private:
+    Successors successors_of_row(size_t row) const
+    {
+        if (packed_at[row] == PLAIN)
+            return Successors(rows[row]);
+
+        const uint8_t *bytes = packed.data() + packed_at[row];
+        size_t count = read_varint(bytes);
+        return Successors(nullptr, bytes, count);
+    }
+
+    index_vec_type plain_row(size_t row) const
+    {
+        Successors values = successors_of_row(row);
+        return index_vec_type(values.begin(), values.end());
+    }
+
+    static Successors sorted(const index_vec_type &values)
+    {
+        assert(std::is_sorted(values.begin(), values.end()) && "finalize() sorts the sets");
+        return Successors(values);
+    }
+
+    static bool read_varint_from(FILE *f, size_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int byte = getc(f);
+            if (byte == EOF)
+                return false;
+
+            value |= size_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    /// Appends one row of `f` to `bytes` as it is encoded, checking that its
+    /// values are increasing states
+    static bool read_row(FILE *f, size_t card, std::vector<uint8_t> &bytes)
+    {
+        size_t count;
+        if (!read_varint_from(f, count) || count > card)
+            return false;
+        write_varint(bytes, count);
+
+        size_t value = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t gap;
+            if (!read_varint_from(f, gap) || (i && !gap) || gap >= card - value)
+                return false;
+
+            value += gap;
+            write_varint(bytes, gap);
+        }
+        return true;
+    }
+
+    /// Values of the one row in `bytes`, which is cleared
+    static index_vec_type decode(std::vector<uint8_t> &bytes)
+    {
+        const uint8_t *begin = bytes.data();
+        size_t count = read_varint(begin);
+        Successors values(nullptr, begin, count);
+
+        index_vec_type result(values.begin(), values.end());
+        bytes.clear();
+        return result;
+    }
+
+    template<class Values>
+    static void write_set_to(FILE *f, const Values &values)
+    {
+        fprintf(f, "%zu ", values.size());
+        for (size_t v : values)
+        {
+            fprintf(f, "%zu ", v);
+        }
+        fputs("\n", f);
+    }
+
+    static void deduplicate(index_vec_type &values)
+    {
+        std::sort(values.begin(), values.end());
+        index_vec_type::iterator it =
+            std::unique(values.begin(), values.end());
+        values.erase(it, values.end());
+    }
+};
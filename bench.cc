@@ -0,0 +1,327 @@
+// Benchmark of the translation phases on scalable LTL formula families, the
+// `bench` target of CMakeLists.txt.
+//
+//     ./bench [--family NAME] [--max-n N] [--repeat R] [--json] [--baseline old.csv]
+//
+// Every row reports the best of R runs per phase in microseconds, the size of
+// the result and the peak RSS of the process so far. CSV output can be saved
+// and passed back with --baseline to print the speedup of every row.
+
+#include "stats.h"
+#include "translator.h"
+
+#include <sys/resource.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Sample
+{
+    std::string family;
+    int n;
+    std::string formula;
+    double micros[PHASES_COUNT];
+    double total;
+    size_t closure;
+    size_t states;
+    size_t edges;
+    long peak_rss_kb;
+};
+
+static std::string nested_untils(int n)
+{
+    std::string s = "p" + std::to_string(n);
+    for (int i = n - 1; i >= 0; i--)
+        s = "(p" + std::to_string(i) + " U " + s + ")";
+    return s;
+}
+
+static std::string fairness(int n)
+{
+    std::string s;
+    for (int i = 0; i < n; i++)
+    {
+        if (i)
+            s += " & ";
+        s += "G F p" + std::to_string(i);
+    }
+    return s;
+}
+
+static std::string x_chain(int n)
+{
+    std::string s = "p";
+    for (int i = 0; i < n; i++)
+        s = "X " + s;
+    return "G (q -> " + s + ")";
+}
+
+/// Random formula of `n` operators over 4 atoms, the same for a given `n`
+static std::string random_formula(int n)
+{
+    static const char *unary[] = {"!", "X ", "F ", "G "};
+    static const char *binary[] = {" & ", " | ", " -> ", " U ", " R ", " W "};
+
+    std::mt19937 rng(0x5eed + n);
+    std::vector<std::string> operands;
+
+    for (int i = 0; i <= n; i++)
+        operands.push_back("p" + std::to_string(rng() % 4));
+
+    // combine random operands until one is left, drawing unary operators at
+    // the same rate as binary ones
+    while (operands.size() > 1 || n > 0)
+    {
+        size_t i = rng() % operands.size();
+        if (rng() % 2 || operands.size() == 1)
+        {
+            operands[i] = unary[rng() % 4] + operands[i];
+        }
+        else
+        {
+            size_t j = (i + 1 + rng() % (operands.size() - 1)) % operands.size();
+            operands[i] = "(" + operands[i] + binary[rng() % 6] + operands[j] + ")";
+            operands.erase(operands.begin() + j);
+        }
+        n--;
+    }
+
+    return operands.front();
+}
+
+static const struct
+{
+    const char *name;
+    std::string (*generate)(int);
+    int max_n;
+} FAMILIES[] = {
+    {"until", nested_untils, 5},
+    {"fairness", fairness, 3},
+    {"xchain", x_chain, 8},
+    {"random", random_formula, 6}};
+
+static long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static bool measure(Translator &translator, FILE *sink, Sample &sample, int repeat)
+{
+    for (int phase = 0; phase < PHASES_COUNT; phase++)
+        sample.micros[phase] = 1e300;
+
+    for (int run = 0; run < repeat; run++)
+    {
+        StatsReport<> report;
+
+        report.begin(PARSE);
+        ref_ptr<Ltl> ltl = translator.parse(sample.formula.c_str());
+        report.end(PARSE);
+
+        if (!ltl)
+        {
+            fprintf(stderr, "%s/%d: parse error at %zu: %s\n", sample.family.c_str(), sample.n,
+                    translator.error().position, translator.error().message.c_str());
+            return false;
+        }
+
+        auto maton = translator.translate(ltl, report);
+
+        report.begin(OUTPUT);
+        maton->write_to(sink);
+        fflush(sink);
+        report.end(OUTPUT);
+
+        for (int phase = 0; phase < PHASES_COUNT; phase++)
+        {
+            if (report.stats.micros[phase] < sample.micros[phase])
+                sample.micros[phase] = report.stats.micros[phase];
+        }
+
+        sample.closure = report.stats.closure;
+        sample.states = report.stats.states;
+        sample.edges = report.stats.edges;
+    }
+
+    sample.total = 0;
+    for (int phase = 0; phase < PHASES_COUNT; phase++)
+        sample.total += sample.micros[phase];
+
+    sample.peak_rss_kb = peak_rss_kb();
+    return true;
+}
+
+/// Totals of a previous CSV run by "family/n"
+static std::map<std::string, double> load_baseline(const char *file_name)
+{
+    std::map<std::string, double> totals;
+
+    FILE *f = fopen(file_name, "r");
+    if (!f)
+    {
+        fprintf(stderr, "Can not open baseline `%s`\n", file_name);
+        return totals;
+    }
+
+    char line[1 << 16];
+    int total_column = -1;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        std::vector<std::string> fields;
+        std::string field;
+        bool quoted = false;
+
+        for (const char *c = line; *c && *c != '\n'; c++)
+        {
+            if (*c == '"')
+                quoted = !quoted;
+            else if (*c == ',' && !quoted)
+            {
+                fields.push_back(field);
+                field.clear();
+            }
+            else
+                field.push_back(*c);
+        }
+        fields.push_back(field);
+
+        if (total_column < 0)
+        {
+            for (size_t i = 0; i < fields.size(); i++)
+            {
+                if (fields[i] == "total_us")
+                    total_column = i;
+            }
+            continue;
+        }
+
+        if (total_column >= 0 && fields.size() > (size_t) total_column)
+            totals[fields[0] + "/" + fields[1]] = atof(fields[total_column].c_str());
+    }
+
+    fclose(f);
+    return totals;
+}
+
+static void write_csv_header(bool with_baseline)
+{
+    printf("family,n,formula");
+    for (const char *name : PHASE_NAMES)
+        printf(",%s_us", name);
+    printf(",total_us,closure,states,edges,peak_rss_kb%s\n", with_baseline ? ",speedup" : "");
+}
+
+static void write_csv(const Sample &sample, const std::map<std::string, double> &baseline, bool with_baseline)
+{
+    printf("%s,%d,\"%s\"", sample.family.c_str(), sample.n, sample.formula.c_str());
+    for (double micros : sample.micros)
+        printf(",%.1f", micros);
+    printf(",%.1f,%zu,%zu,%zu,%ld", sample.total, sample.closure, sample.states, sample.edges, sample.peak_rss_kb);
+
+    if (with_baseline)
+    {
+        auto it = baseline.find(sample.family + "/" + std::to_string(sample.n));
+        if (it != baseline.end() && sample.total > 0)
+            printf(",%.3f", it->second / sample.total);
+        else
+            printf(",");
+    }
+
+    printf("\n");
+}
+
+static void write_json(const Sample &sample, bool first)
+{
+    printf("%s\n  {\"family\": \"%s\", \"n\": %d, \"formula\": \"%s\"", first ? "" : ",",
+           sample.family.c_str(), sample.n, sample.formula.c_str());
+    for (int phase = 0; phase < PHASES_COUNT; phase++)
+        printf(", \"%s_us\": %.1f", PHASE_NAMES[phase], sample.micros[phase]);
+    printf(", \"total_us\": %.1f, \"closure\": %zu, \"states\": %zu, \"edges\": %zu, \"peak_rss_kb\": %ld}",
+           sample.total, sample.closure, sample.states, sample.edges, sample.peak_rss_kb);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *family = nullptr;
+    const char *baseline_name = nullptr;
+    int max_n = 0;
+    int repeat = 3;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--family") && i + 1 < argc)
+            family = argv[++i];
+
+        else if (!strcmp(argv[i], "--max-n") && i + 1 < argc)
+            max_n = atoi(argv[++i]);
+
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+
+        else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+            baseline_name = argv[++i];
+
+        else if (!strcmp(argv[i], "--json"))
+            json = true;
+
+        else
+        {
+            fprintf(stderr, "Usage: %s [--family until|fairness|xchain|random] [--max-n N] [--repeat R] [--json] [--baseline old.csv]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baseline_name)
+        baseline = load_baseline(baseline_name);
+
+    FILE *sink = fopen("/dev/null", "w");
+    Translator translator;
+    bool first = true;
+
+    if (json)
+        printf("[");
+    else
+        write_csv_header(baseline_name);
+
+    for (const auto &item : FAMILIES)
+    {
+        if (family && strcmp(family, item.name))
+            continue;
+
+        for (int n = 1; n <= (max_n ? max_n : item.max_n); n++)
+        {
+            Sample sample;
+            sample.family = item.name;
+            sample.n = n;
+            sample.formula = item.generate(n);
+
+            if (!measure(translator, sink, sample, repeat < 1 ? 1 : repeat))
+                return 1;
+
+            if (json)
+                write_json(sample, first);
+            else
+                write_csv(sample, baseline, baseline_name);
+
+            first = false;
+            fflush(stdout);
+        }
+    }
+
+    if (json)
+        printf("\n]\n");
+
+    fclose(sink);
+    return 0;
+}
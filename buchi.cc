@@ -1,1560 +1,680 @@
-#include "ref_ptr.h"
-#include "split_tree.h"
+#include "alternating.h"
+#include "compose.h"
+#include "kripke.h"
 #include "latex_export.h"
+#include "model_checker.h"
+#include "pdf_pool.h"
+#include "stats.h"
+#include "stutter.h"
+#include "translator.h"
 
-#include <cassert>
-#include <cstddef>
-
-#include <algorithm>
-#include <memory>
-#include <string>
-#include <vector>
-#include <cmath>
-#include <cstring>
 #include <unistd.h>
 
-bool REVERSED_MASK = false;
-bool COMPACT_TABLE = false;
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-enum class Operator : uint8_t
-{
-    TRUE,
-    FALSE,
-    ATOM,
-    UNARY_FIRST,
-    NOT = UNARY_FIRST,
-    X,
-    F,
-    G,
-    BINARY_FIRST,
-    AND = BINARY_FIRST,
-    OR,
-    IMPL,
-    U,
-    W,
-    R
-};
+#include <atomic>
+#include <new>
+#include <numeric>
+#include <string>
+#include <vector>
 
-enum class Status : uint8_t
-{
-    UNKNOWN, TRUE, FALSE
-};
+#ifdef BUCHI_COUNT_ALLOCATIONS
 
-using node_ptr = std::shared_ptr<Node<std::vector<Status>>>;
+// Every allocation of the process is counted for --stats, from every thread.
+// The operators are kept out of line, so the compiler pairs every delete with
+// a new instead of a free() with the malloc() it would inline.
+static std::atomic<size_t> allocations(0);
 
-static const struct
+__attribute__((noinline)) void *operator new(size_t size)
 {
-    char sym;
-    Operator opc;
-} opcodes[] = {
-    {'!', Operator::NOT},
-    {'&', Operator::AND},
-    {'|', Operator::OR},
-    {'U', Operator::U},
-    {'F', Operator::F},
-    {'G', Operator::G},
-    {'R', Operator::R},
-    {'W', Operator::W},
-    {'X', Operator::X}};
-
-static const std::string DEFINITION_NAMES[] = {
-    "\\alpha",
-    "\\beta",
-    "\\gamma",
-    "\\delta",
-    "\\varepsilon",
-    "\\zeta",
-    "\\eta",
-    "\\vartheta",
-    "\\mu",
-    "\\nu",
-    "\\xi",
-    "\\rho",
-    "\\sigma",
-    "\\chi",
-    "\\psi",
-    "\\omega"
-};
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
 
-static char symbol_of(Operator opc)
+__attribute__((noinline)) void *operator new[](size_t size)
 {
-    for (const auto &item : opcodes)
-    {
-        if (item.opc == opc)
-        {
-            return item.sym;
-        }
-    }
-    return '\0';
+    return operator new(size);
 }
 
-static Operator opcode_of(char c)
+__attribute__((noinline)) void operator delete(void *p) noexcept
 {
-    for (const auto &item : opcodes)
-    {
-        if (item.sym == c)
-        {
-            return static_cast<Operator>(item.opc);
-        }
-    }
-    return Operator::FALSE;
+    free(p);
 }
 
-template<class T>
-void add_if_not_presented(std::vector<T*>& vector, T* to_add)
+__attribute__((noinline)) void operator delete[](void *p) noexcept
 {
-    for (auto ltl : vector)
-    {
-        if (*to_add == *ltl)
-            return;
-    }
-
-    vector.push_back(to_add);
+    free(p);
 }
 
-template<class T>
-int find_if_presented(const std::vector<T>& vector, const T to_found)
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
 {
-    for (int i = 0; i < vector.size(); i++)
-    {
-        if (*to_found == *(vector[i]))
-            return i;
-    }
-
-    return -1;
+    free(p);
 }
 
-class Ltl
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept
 {
-    friend void ref_ptr_inc_ref(Ltl &);
-    friend void ref_ptr_release(Ltl &);
+    free(p);
+}
 
-public:
-    using ref_type = ref_ptr<Ltl>;
+#else
 
-    static ref_type True()
-    {
-        static const ref_type ltl_true = new Ltl(Operator::TRUE);
-        return ltl_true;
-    }
+// Without BUCHI_COUNT_ALLOCATIONS the stock allocator is kept and --stats
+// reports no allocations
+static constexpr size_t allocations = 0;
 
-    static ref_type False()
-    {
-        static const ref_type ltl_false = new Ltl(Operator::FALSE);
-        return ltl_false;
-    }
+#endif
 
-    static ref_type atom(std::string name)
-    {
-        return new Ltl(std::move(name));
-    }
-
-    static ref_type unary(Operator opc, const ref_type &opnd)
-    {
-        ref_type ltl = new Ltl(opc);
-        ltl->lop = opnd;
-
-        return ltl;
-    }
+static void dump_ltl(const std::string &file_name, const Ltl *ltl)
+{
+    FILE* f = fopen(file_name.c_str(), "w");
+    ltl->dump_to(f);
+    fclose(f);
+}
 
-    static ref_type binary(Operator opc, const ref_type &lop, const ref_type &rop)
-    {
-        ref_type ltl = new Ltl(opc);
-        ltl->lop = lop;
-        ltl->rop = rop;
 
-        return ltl;
-    }
+/// Parse time and allocations of the formula, which come before the report
+struct Parsing
+{
+    const char *formula;
+    double micros;
+    size_t allocations;
+};
 
-    Operator kind() const
-    {
-        return opc;
-    }
+/// Command line settings shared by every formula of a run
+struct Settings
+{
+    bool quiet = false;
+    bool compact = false;
+    bool stats = false;
+    bool batch = false;             // more than one formula, the output files are numbered
+    bool alternating = false;       // --engine vwaa
+    bool stutter = false;           // reduce the automata of formulas without X
+    bool compose = false;           // translate top-level conjuncts apart
+    bool shared = false;            // translate all formulas from one tableau
+    bool compress = false;          // compressed rows, the automaton is written in binary
+    const char *scratch = nullptr;  // directory of the runs of --external
+    bool count = false;             // only count states and transitions
+    const char *output = nullptr;   // report name given by -o
+    const char *model = nullptr;    // Kripke structure given by --model
+};
 
-    const Ltl *lhs() const
-    {
-        return lop.get();
-    }
+/// `name` with the number of the formula inserted before its extension when
+/// a batch is translated
+static std::string numbered(const std::string &name, size_t number, const Settings &settings)
+{
+    if (!settings.batch)
+        return name;
 
-    const Ltl *rhs() const
-    {
-        return rop.get();
-    }
+    size_t slash = name.rfind('/');
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = name.size();
 
-    void to_string(std::string &s) const
-    {
-        switch (opc)
-        {
-            case Operator::TRUE:
-                s.append("true");
-                break;
-            case Operator::FALSE:
-                s.append("false");
-                break;
-            case Operator::ATOM:
-                s.append(name);
-                break;
-
-            case Operator::IMPL:
-                s.push_back('(');
-                lop->to_string(s);
-                s.append(" -> ");
-                rop->to_string(s);
-                s.push_back(')');
-                break;
-
-            case Operator::NOT:
-            case Operator::G:
-            case Operator::F:
-            case Operator::X:
-                s.push_back(symbol_of(opc));
-                lop->to_string(s);
-                break;
-
-            case Operator::AND:
-            case Operator::OR:
-            case Operator::U:
-            case Operator::R:
-            case Operator::W:
-                s.push_back('(');
-                lop->to_string(s);
-                s.push_back(' ');
-                s.push_back(symbol_of(opc));
-                s.push_back(' ');
-                rop->to_string(s);
-                s.push_back(')');
-                break;
-        }
-    }
+    return name.substr(0, dot) + "_" + std::to_string(number) + name.substr(dot);
+}
 
-    // returns true if not presented "until" found in current subtree, false if not found 
-    bool find_nested_untils(std::vector<const Ltl*>& untils, std::vector<const Ltl*>& currently_found, bool first_call = true) const
-    {
-        bool already_found = false;
+/// With --compress or --external the automaton goes to automaton.gba in the
+/// binary format of Automaton::write_binary_to, and to automaton.dot otherwise
+static std::string automaton_name_of(size_t number, const Settings &settings)
+{
+    bool binary = settings.compress || settings.scratch;
+    return numbered(binary ? "automaton.gba" : "automaton.dot", number, settings);
+}
 
-        if (lhs())
-            already_found |= lhs()->find_nested_untils(untils, currently_found, false);
-        if (rhs())
-            already_found |= rhs()->find_nested_untils(untils, currently_found, false);
+static void write_automaton(const std::string &file_name, const Automaton &maton, const Settings &settings)
+{
+    FILE* f = fopen(file_name.c_str(), settings.compress ? "wb" : "w");
+    if (settings.compress)
+        maton.write_binary_to(f);
+    else
+        maton.write_graph_to(f);
+    fclose(f);
+}
 
-        if (not first_call and kind() == Operator::U and not already_found and find_if_presented(untils, this) == -1)
-        {
-            add_if_not_presented(untils, this);
-            add_if_not_presented(currently_found, this);
-            already_found = true;
-        }
+/// The .tex file a report named `output` is written to
+static std::string tex_name_of(const char *output)
+{
+    std::string tex_name = output;
 
-        return already_found;
-    }
+    size_t last_dot = tex_name.rfind('.');
+    if (last_dot == std::string::npos)
+        tex_name += ".tex";
 
-    std::string to_latex_string(std::vector<const Ltl*> definitions = std::vector<const Ltl*>(), std::vector<const Ltl*> just_announced = std::vector<const Ltl*>(), const Ltl* initial_ltl = nullptr) const
-    {
-        if (initial_ltl and *this == *initial_ltl)
-            return "\\varphi";
+    else if (tex_name.compare(last_dot, std::string::npos, ".pdf") == 0)
+        tex_name.replace(last_dot, std::string::npos, ".tex");
 
-        std::string s;
+    else if (tex_name.compare(last_dot, std::string::npos, ".tex") != 0)
+        tex_name += ".tex";
 
-        switch (opc)
-        {
-            case Operator::TRUE:
-                s.append("\\TRUE");
-                break;
-            case Operator::FALSE:
-                s.append("\\FALSE");
-                break;
-            case Operator::ATOM:
-                s.append(name);
-                break;
-
-            case Operator::IMPL:
-                s.push_back('(');
-                s.append(lop->to_latex_string(definitions, just_announced));
-                s.append(" \\IMPL ");
-                s.append(rop->to_latex_string(definitions, just_announced));
-                s.push_back(')');
-                break;
-
-            case Operator::NOT:
-                s.append("\\NOT ");
-                s.append(lop->to_latex_string(definitions, just_announced));
-                break;
-
-            case Operator::G:
-                s.append("\\GLOBALLY ");
-                s.append(lop->to_latex_string(definitions, just_announced));
-                break;
-
-            case Operator::F:
-                s.append("\\FUTURE ");
-                s.append(lop->to_latex_string(definitions, just_announced));
-                break;
-
-            case Operator::X:
-                s.append("\\NEXT ");
-                s.append(lop->to_latex_string(definitions, just_announced));
-                break;
-
-            case Operator::AND:
-                s.push_back('(');
-                s.append(lop->to_latex_string(definitions, just_announced));
-                s.append(" \\AND ");
-                s.append(rop->to_latex_string(definitions, just_announced));
-                s.push_back(')');
-                break;
-
-            case Operator::OR:
-                s.push_back('(');
-                s.append(lop->to_latex_string(definitions, just_announced));
-                s.append(" \\OR ");
-                s.append(rop->to_latex_string(definitions, just_announced));
-                s.push_back(')');
-                break;
-
-            case Operator::U:
-            {
-                int definition_idx = find_if_presented(definitions, (const Ltl*) this);
-                bool announced = find_if_presented(just_announced, (const Ltl*) this) >= 0;
-                if (definition_idx >= 0 and not announced)
-                    s.append(DEFINITION_NAMES[definition_idx]);
-                else
-                {
-                    if (definition_idx >= 0 and announced)
-                        s.append("\\overbrace{");
-                    s.push_back('(');
-                    s.append(lop->to_latex_string(definitions, just_announced));
-                    s.append(" \\UNTIL ");
-                    s.append(rop->to_latex_string(definitions, just_announced));
-                    s.push_back(')');
-                    if (definition_idx >= 0 and announced)
-                    {
-                        s.append("}^{");
-                        s.append(DEFINITION_NAMES[definition_idx]);
-                        s.append("}");
-                    }
-                }
-                break;
-            }
+    return tex_name;
+}
 
-            case Operator::R:
-                s.push_back('(');
-                s.append(lop->to_latex_string(definitions, just_announced));
-                s.append(" \\RELEASE ");
-                s.append(rop->to_latex_string(definitions, just_announced));
-                s.push_back(')');
-                break;
-
-            case Operator::W:
-                s.push_back('(');
-                s.append(lop->to_latex_string(definitions, just_announced));
-                s.append(" \\WEAK ");
-                s.append(rop->to_latex_string(definitions, just_announced));
-                s.push_back(')');
-                break;
-        }
+static void write_budget_status(const BudgetStatus &status)
+{
+    fprintf(stderr, "Budget exceeded: %s after %.3f s, %zu states, %zu edges, %zu bytes\n",
+            RESOURCE_NAMES[(int) status.exceeded], status.seconds, status.states, status.edges, status.bytes);
+}
 
-        return s;
-    }
+/// Writes the automaton `translator` built for `ltl`; with --stutter the one
+/// of a formula without X is first reduced by stuttering and marked as
+/// stutter-invariant, which --stats counts as OUTPUT
+template<class Engine>
+static void write_result(const std::string &file_name, const Automaton &maton, const Engine &translator, const ref_ptr<Ltl> &ltl, const Settings &settings)
+{
+    if (settings.stutter && is_stutter_invariant(ltl.get()))
+        write_automaton(file_name, *reduce_stuttering(maton, translator.state_letters()), settings);
+    else
+        write_automaton(file_name, maton, settings);
+}
 
-    std::string node_to_string() const
+/// Translates `ltl` into `automaton_name` with a `Report` built from `args`.
+/// With --stats every phase is measured and one JSON line is written to stderr.
+/// Returns false if the budget is exceeded.
+template<class Report, class... Args>
+static bool translate(Translator &translator, const ref_ptr<Ltl> &ltl, const Parsing &parsing, const std::string &automaton_name, const Settings &settings, Args... args)
+{
+    if (!settings.stats)
     {
-        switch (opc)
+        Report report(args...);
+        auto maton = translator.translate(ltl, report);
+        if (!maton)
         {
-            case Operator::TRUE: return "true";
-            case Operator::FALSE: return "false";
-            case Operator::ATOM: return name;
-            case Operator::IMPL: return "{→|implication}";
-            case Operator::NOT: return "{!|not}";
-            case Operator::G: return "{G|globally}";
-            case Operator::F: return "{F|future}";
-            case Operator::X: return "{X|next}";
-            case Operator::AND: return "{&|and}";
-            case Operator::OR: return "{\\||or}";
-            case Operator::U: return "{U|until}";
-            case Operator::R: return "{R|release}";
-            case Operator::W: return "{W|weak until}";
-            default: return "{|UNKNOWN|}";
+            write_budget_status(translator.budget_status());
+            return false;
         }
-    }
-
-    void dump_to(FILE *f) const
-    {
-        fprintf(f, "digraph G {\trankdir=LR;\n");
-        recursive_dump_to(f);
-        fprintf(f, "}");
-    }
 
-    bool operator==(const Ltl& other) const
-    {
-        return (kind() == other.kind() && (kind() != Operator::ATOM || name == other.name)) && 
-            ((!lhs() && !other.lhs()) || (lhs() && other.lhs() && *lhs() == *other.lhs())) &&
-            ((!rhs() && !other.rhs()) || (rhs() && other.rhs() && *rhs() == *other.rhs()));
+        write_result(automaton_name, *maton, translator, ltl, settings);
+        return true;
     }
 
-    Status calculate(const std::vector<const Ltl*>& all, std::vector<Status>& all_mask) const
-    {
-        #define SET_AND_RETURN(status) { all_mask[mask_idx] = status; return status; }
-
-        int mask_idx;
-        for (mask_idx = 0; mask_idx < all.size(); mask_idx++)
-        {
-            if (*this == *(all[mask_idx]))
-                break;
-        }
-
-        auto l_status = lhs() ? lhs()->calculate(all, all_mask) : Status::UNKNOWN;
-        auto r_status = rhs() ? rhs()->calculate(all, all_mask) : Status::UNKNOWN;
-
-        if (all_mask[mask_idx] != Status::UNKNOWN)
-            return all_mask[mask_idx];
+    size_t allocations_before = allocations;
 
-        switch (kind())
-        {
-            case Operator::TRUE:
-                SET_AND_RETURN(Status::TRUE)
-
-            case Operator::FALSE:
-                SET_AND_RETURN(Status::FALSE)
-
-            case Operator::NOT:
-                switch (l_status)
-                {
-                    case Status::TRUE: SET_AND_RETURN(Status::FALSE)
-                    case Status::FALSE: SET_AND_RETURN(Status::TRUE)
-                    default: SET_AND_RETURN(Status::UNKNOWN)
-                }
-
-            case Operator::AND:
-                if (l_status == Status::TRUE && r_status == Status::TRUE)
-                    SET_AND_RETURN(Status::TRUE)
-                else if (l_status == Status::FALSE || r_status == Status::FALSE)
-                    SET_AND_RETURN(Status::FALSE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::OR:
-                if (l_status == Status::TRUE || r_status == Status::TRUE)
-                    SET_AND_RETURN(Status::TRUE)
-                else if (l_status == Status::FALSE && r_status == Status::FALSE)
-                    SET_AND_RETURN(Status::FALSE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::IMPL:
-                if (l_status == Status::FALSE || r_status == Status::TRUE)
-                    SET_AND_RETURN(Status::TRUE)
-                else if (l_status == Status::TRUE && r_status == Status::FALSE)
-                    SET_AND_RETURN(Status::FALSE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::U:
-                if (r_status == Status::TRUE)
-                    SET_AND_RETURN(Status::TRUE)
-                else if (l_status == Status::FALSE && r_status == Status::FALSE)
-                    SET_AND_RETURN(Status::FALSE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::F:
-                if (l_status == Status::TRUE)
-                    SET_AND_RETURN(Status::TRUE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::G:
-                if (l_status == Status::FALSE)
-                    SET_AND_RETURN(Status::FALSE)
-                else
-                    SET_AND_RETURN(Status::UNKNOWN)
-
-            // [TODO] INCORRECT
-            case Operator::W:
-                printf("Can not calc W\n");
-                SET_AND_RETURN(Status::UNKNOWN)
-            
-            // [TODO] INCORRECT
-            case Operator::R:
-                printf("Can not calc R\n");
-                SET_AND_RETURN(Status::UNKNOWN)
-
-            case Operator::ATOM:
-            case Operator::X:
-            default:
-                printf("UNREACHABLE CODE!\n");
-                SET_AND_RETURN(Status::UNKNOWN)
-        }
-    }
+    StatsReport<Report> report(args...);
+    auto maton = translator.translate(ltl, report);
 
-    bool introduce_X()
+    if (maton)
     {
-        bool changed = false;
-
-        if (kind() == Operator::X)
-        {
-            auto arg = lop;
-
-            switch (arg->kind())
-            {
-                // true or false
-                case Operator::TRUE:
-                case Operator::FALSE:
-                    changed = true;
-                    opc = arg->kind();
-                    lop = nullptr;
-                    rop = nullptr;
-                    break;
-
-                // unary operators
-                case Operator::NOT:
-                case Operator::F:
-                case Operator::G:
-                    changed = true;
-                    opc = arg->kind();
-                    arg->opc = Operator::X;
-                    break;
-
-                // binary operators
-                case Operator::AND:
-                case Operator::OR:
-                case Operator::IMPL:
-                case Operator::U:
-                case Operator::W:
-                case Operator::R:
-                    changed = true;
-                    opc = arg->kind();
-                    lop = unary(Operator::X, arg->lop);
-                    rop = unary(Operator::X, arg->rop);
-                    arg->lop = nullptr;
-                    arg->rop = nullptr;
-                    break;
-            }
-        }
-
-        if (lhs())
-            changed |= lop->introduce_X();
-        if (rhs())
-            changed |= rop->introduce_X();
-
-        return changed;
+        report.begin(OUTPUT);
+        write_result(automaton_name, *maton, translator, ltl, settings);
+        report.end(OUTPUT);
     }
+    else
+        write_budget_status(translator.budget_status());
 
-    bool substitute_R()
-    {
-        bool changed = false;
-
-        if (kind() == Operator::R)
-        {
-            changed = True;
-            opc = Operator::NOT;
-            lop = binary(Operator::U, unary(Operator::NOT, lop), unary(Operator::NOT, rop));
-            rop = nullptr;
-        }
+    report.stats.micros[PARSE] = parsing.micros;
+    report.stats.allocations = parsing.allocations + allocations - allocations_before;
+    report.stats.write_json(stderr, parsing.formula);
 
-        if (lhs())
-            changed |= lop->substitute_R();
-        if (rhs())
-            changed |= rop->substitute_R();
-        
-        return changed;
-    }
+    return maton != nullptr;
+}
 
-    bool substitute_W()
-    {
-        bool changed = false;
+/// Translates `ltl` into `automaton_name` through alternating automata; the
+/// construction is counted as the STATES phase by --stats. Returns false if
+/// the budget is exceeded.
+static bool translate_alternating(AlternatingTranslator &translator, const ref_ptr<Ltl> &ltl, const Parsing &parsing, const std::string &automaton_name, const Settings &settings)
+{
+    size_t allocations_before = allocations;
+    auto construction_start = stats_clock::now();
 
-        if (kind() == Operator::W)
-        {
-            changed = True;
-            opc = Operator::OR;
-            auto new_lop = binary(Operator::U, lop, rop);
-            auto new_rop = unary(Operator::G, lop);
-            lop = new_lop;
-            rop = new_rop;
-        }
+    auto maton = translator.translate(ltl);
 
-        if (lhs())
-            changed |= lop->substitute_W();
-        if (rhs())
-            changed |= rop->substitute_W();
-        
-        return changed;
-    }
+    Stats report;
+    report.micros[STATES] = std::chrono::duration<double, std::micro>(stats_clock::now() - construction_start).count();
 
-    bool substitute_G()
+    if (maton)
     {
-        bool changed = false;
-
-        if (kind() == Operator::G)
-        {
-            changed = True;
-            opc = Operator::NOT;
-            lop = unary(Operator::F, unary(Operator::NOT, lop));
-        }
-
-        if (lhs())
-            changed |= lop->substitute_G();
-        if (rhs()) 
-            changed |= rop->substitute_G();
-
-        return changed;
+        auto output_start = stats_clock::now();
+        write_result(automaton_name, *maton, translator, ltl, settings);
+        report.micros[OUTPUT] = std::chrono::duration<double, std::micro>(stats_clock::now() - output_start).count();
     }
+    else
+        write_budget_status(translator.budget_status());
 
-    bool substitute_F()
+    if (settings.stats)
     {
-        bool changed = false;
+        report.micros[PARSE] = parsing.micros;
+        report.closure = translator.alternating_size();
+        report.states = translator.budget_status().states;
+        report.edges = translator.budget_status().edges;
+        report.allocations = parsing.allocations + allocations - allocations_before;
+        report.exceeded = translator.budget_status().exceeded;
+        report.write_json(stderr, parsing.formula);
+    }
 
-        if (kind() == Operator::F)
-        {
-            changed = True;
-            opc = Operator::U;
-            rop = lop;
-            lop = True();
-        }
+    return maton != nullptr;
+}
 
-        if (lhs())
-            changed |= lop->substitute_F();
-        if (rhs())
-            changed |= rop->substitute_F();
+/// Translates `ltl` into `automaton_name` conjunct by conjunct; the whole
+/// construction is counted as the STATES phase by --stats and the states of
+/// the reduced conjuncts as the closure. Returns false if the budget is
+/// exceeded.
+static bool translate_compositional(CompositionalTranslator &translator, const ref_ptr<Ltl> &ltl, const Parsing &parsing, const std::string &automaton_name, const Settings &settings)
+{
+    size_t allocations_before = allocations;
+    auto construction_start = stats_clock::now();
 
-        return changed;
-    }
+    auto maton = translator.translate(ltl);
 
-private:
-    Ltl(std::string _name)
-    {
-        nref = 0;
-        opc = Operator::ATOM;
-        name = std::move(_name);
-        lop = nullptr;
-        rop = nullptr;
-    }
+    Stats report;
+    report.micros[STATES] = std::chrono::duration<double, std::micro>(stats_clock::now() - construction_start).count();
 
-    Ltl(Operator _opc)
+    if (maton)
     {
-        nref = 0;
-        opc = _opc;
-        lop = nullptr;
-        rop = nullptr;
+        auto output_start = stats_clock::now();
+        write_result(automaton_name, *maton, translator, ltl, settings);
+        report.micros[OUTPUT] = std::chrono::duration<double, std::micro>(stats_clock::now() - output_start).count();
     }
+    else
+        write_budget_status(translator.budget_status());
 
-    Ltl(const Ltl &) = delete;
-    void operator=(const Ltl &) = delete;
-
-    void recursive_dump_to(FILE *f) const
+    if (settings.stats)
     {
-        fprintf(f, "\taddr%p[label=", this);
-
-        fprintf(f, "\"{%s|{kind = %d}}\"", node_to_string().c_str(), kind());
-
-        fprintf(f, ", shape=\"record\"]\n");
-
-        if (lhs())
-        {
-            lhs()->recursive_dump_to(f);
-            fprintf(f, "\taddr%p -> addr%p[label=\".lhs\"]\n", this, lhs());
-        }
-
-        if (rhs())
-        {
-            rhs()->recursive_dump_to(f);
-            fprintf(f, "\taddr%p -> addr%p[label=\".rhs\"]\n", this, rhs());
-        }
+        std::vector<size_t> sizes = translator.factor_sizes();
+        report.micros[PARSE] = parsing.micros;
+        report.closure = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+        report.states = translator.budget_status().states;
+        report.edges = translator.budget_status().edges;
+        report.allocations = parsing.allocations + allocations - allocations_before;
+        report.exceeded = translator.budget_status().exceeded;
+        report.write_json(stderr, parsing.formula);
     }
 
-    int nref;
-    Operator opc;
-    std::string name;
-    ref_type lop, rop;
-};
-
-void ref_ptr_inc_ref(Ltl &x)
-{
-    ++x.nref;
-}
-
-void ref_ptr_release(Ltl &x)
-{
-    --x.nref;
-    if (x.nref <= 0)
-    {
-        delete &x;
-    }
+    return maton != nullptr;
 }
 
-class Parser
+/// Translates `ltl` into `automaton_name` through runs of edges on disk; the
+/// construction and the merge are counted as the STATES phase by --stats.
+/// Returns the exit code of the formula.
+static int translate_external(Translator &translator, const ref_ptr<Ltl> &ltl, const Parsing &parsing, const std::string &automaton_name, const Settings &settings)
 {
-    const char *stream;
-    std::vector<ref_ptr<Ltl>> stack;
-
-public:
-    ref_ptr<Ltl> parse(const char *s)
+    FILE *f = fopen(automaton_name.c_str(), "wb");
+    if (!f)
     {
-        stream = s;
-        parse_until('\0');
-
-        assert(stack.size() == 1);
-        ref_ptr<Ltl> ltl = stack.back();
-        stack.pop_back();
-
-        return ltl;
+        fprintf(stderr, "Can not open `%s`\n", automaton_name.c_str());
+        return 1;
     }
 
-private:
-    void parse_until(char endsym)
-    {
-        char c = *stream;
-        while (c && c != endsym)
-        {
-            parse_term();
-            c = *stream;
-        }
-        assert(c == endsym && "invalid end of stream");
-
-        if (c && c == endsym)
-        {
-            ++stream;
-        }
-    }
+    size_t allocations_before = allocations;
+    auto construction_start = stats_clock::now();
 
-    void skip_empty()
-    {
-        const char *s = stream;
-        while (*s && isspace(*s))
-        {
-            ++s;
-        }
-        stream = s;
-    }
-
-    ref_ptr<Ltl> parse_atom()
-    {
-        const char *end = stream;
-        while (*end && islower(*end))
-        {
-            ++end;
-        }
-        assert(stream < end && "invalid atom token");
-
-        std::string name(stream, end);
-        stream = end;
-
-        if (name == "true")
-        {
-            return Ltl::True();
-        }
-        if (name == "false")
-        {
-            return Ltl::False();
-        }
-        return Ltl::atom(std::move(name));
-    }
-
-    void parse_term()
-    {
-        skip_empty();
+    bool translated = translator.translate_to_file(ltl, f, settings.scratch);
+    fclose(f);
 
-        const char c = *stream;
-        switch (c)
-        {
-            default:
-                stack.push_back(parse_atom());
-                break;
-
-            case '!':
-            case 'X':
-            case 'F':
-            case 'G':
-                ++stream;
-                parse1(opcode_of(c));
-                break;
-
-            case '&':
-            case '|':
-            case 'U':
-            case 'R':
-            case 'W':
-                ++stream;
-                parse2(opcode_of(c));
-                break;
-
-            case '-':
-                assert(stream[1] == '>' && "invalid token");
-                stream += 2;
-                parse2(Operator::IMPL);
-                break;
-
-            case '(':
-                ++stream;
-                parse_until(')');
-                break;
-
-            case ')':
-                break;
-        }
-    }
+    Stats report;
+    report.micros[STATES] = std::chrono::duration<double, std::micro>(stats_clock::now() - construction_start).count();
 
-    void parse1(Operator opc)
-    {
-        parse_term();
-        ref_ptr<Ltl> ltl = pop();
-        stack.push_back(Ltl::unary(opc, ltl));
-    }
+    if (!translated && !translator.external_error().empty())
+        fprintf(stderr, "%s\n", translator.external_error().c_str());
+    else if (!translated)
+        write_budget_status(translator.budget_status());
 
-    void parse2(Operator opc)
+    if (settings.stats)
     {
-        parse_term();
-        ref_ptr<Ltl> rop = pop();
-        ref_ptr<Ltl> lop = pop();
-        stack.push_back(Ltl::binary(opc, lop, rop));
+        report.micros[PARSE] = parsing.micros;
+        report.states = translator.budget_status().states;
+        report.edges = translator.budget_status().edges;
+        report.allocations = parsing.allocations + allocations - allocations_before;
+        report.exceeded = translator.budget_status().exceeded;
+        report.write_json(stderr, parsing.formula);
     }
 
-    ref_ptr<Ltl> pop()
-    {
-        ref_ptr<Ltl> ltl = stack.back();
-        stack.pop_back();
-        return ltl;
-    }
-};
+    return translated ? 0 : 2;
+}
 
-class Automaton
+/// Counts the automaton of `ltl` and writes one JSON line to stdout with its
+/// states, initial states, states of every acceptance set and transitions.
+/// Returns the exit code of the formula.
+static int count_formula(Translator &translator, const ref_ptr<Ltl> &ltl, const char *formula)
 {
-    using index_vec_type = std::vector<size_t>;
-
-    std::vector<index_vec_type> adjacent;
-    std::vector<index_vec_type> accepting;
-    index_vec_type initial;
-
-public:
-    Automaton(const Automaton &) = delete;
-    Automaton &operator=(const Automaton &) = delete;
-
-    /// Init automaton for a given number of states
-    Automaton(size_t card)
+    AutomatonCounts counts;
+    if (!translator.count(ltl, counts))
     {
-        adjacent.resize(card);
+        write_budget_status(translator.budget_status());
+        return 2;
     }
 
-    void add_transition(size_t src, size_t dst)
+    printf("{\"formula\": \"");
+    for (const char *c = formula; *c; c++)
     {
-        adjacent[src].push_back(dst);
+        if (*c == '"' || *c == '\\')
+            putchar('\\');
+        putchar(*c);
     }
 
-    void mark_init(size_t state)
-    {
-        assert(state < adjacent.size() && "invalid state number");
-        initial.push_back(state);
-    }
+    printf("\", \"states\": %zu, \"initial\": %zu, \"accepting\": [", counts.states, counts.initial);
+    for (size_t set = 0; set < counts.accepting.size(); set++)
+        printf("%s%zu", set ? ", " : "", counts.accepting[set]);
+    printf("], \"edges\": %zu}\n", counts.edges);
 
-    void mark_accept(size_t set, size_t state)
-    {
-        assert(state < adjacent.size() && "invalid state number");
-        if (set >= accepting.size())
-        {
-            accepting.resize(set + 1);
-        }
-        accepting[set].push_back(state);
-    }
+    return 0;
+}
 
-    void finalize()
-    {
-        for (index_vec_type &values : adjacent)
-        {
-            deduplicate(values);
-        }
-        for (index_vec_type &values : accepting)
-        {
-            deduplicate(values);
-        }
-        deduplicate(initial);
-    }
+/// Translates one formula of the run and hands its report to `pool`.
+/// Returns the exit code of the formula.
+static int translate_formula(Translator &translator, AlternatingTranslator &alternating, CompositionalTranslator &compositional,
+                             const char *formula, size_t number, const Settings &settings, PdfPool &pool)
+{
+    Parsing parsing = {formula, 0, allocations};
+    auto parse_start = stats_clock::now();
+    ref_ptr<Ltl> ltl = translator.parse(parsing.formula);
+    parsing.micros = std::chrono::duration<double, std::micro>(stats_clock::now() - parse_start).count();
+    parsing.allocations = allocations - parsing.allocations;
 
-    void write_to(FILE *f) const
+    if (!ltl)
     {
-        fprintf(f, "%zu %zu\n", adjacent.size(), accepting.size());
-        write_set_to(f, initial);
-        for (const index_vec_type &accepting_set : accepting)
-        {
-            write_set_to(f, accepting_set);
-        }
-
-        size_t i = 0;
-        for (const index_vec_type &transitions : adjacent)
-        {
-            write_set_to(f, transitions);
-            ++i;
-        }
+        if (settings.batch)
+            fprintf(stderr, "Formula %zu: ", number);
+        fprintf(stderr, "Parse error at position %zu: %s\n", translator.error().position, translator.error().message.c_str());
+        return 1;
     }
 
-    void write_graph_to(FILE* f) const
-    {
-        fprintf(f, "digraph G {\n\tgraph[dpi = 400];\n\tlayout=\"circo\";\n\trankdir=TB;\n");
-        
-        // Creating dummy nodes for initial states
-        for (int i = 0; i < initial.size(); i++)
-            fprintf(f, "\tn%d[label=\"\",shape=none,height=.0,width=.0]\n", i);
-
-        fprintf(f, "\n");
-
-        // Creating state nodes
-        for (int i = 0; i < card(); i++)
-        {
-            fprintf(f, "\ts%d[shape=\"circle\"", i + 1);
-
-            bool is_accepting = false;
-            for (auto ac_vec : accepting)
-            {
-                for (auto ac : ac_vec)
-                {
-                    if (ac == i)
-                        is_accepting = true;
-                }
-            }
-
-            if (is_accepting)
-                fprintf(f, ", peripheries=2]\n");
-            else
-                fprintf(f, "]\n");
-        }
-
-        fprintf(f, "\n");
-
-        // Adding edges from nowhere to initial nodes
-        for (int i = 0; i < initial.size(); i++)
-            fprintf(f, "\tn%d->s%d\n", i, initial[i] + 1);
-
-        fprintf(f, "\n");
+    // nothing is written but the counts
+    if (settings.count)
+        return count_formula(translator, ltl, parsing.formula);
 
-        // Adding edges between nodes
-        for (int i = 0; i < adjacent.size(); i++)
-        {
-            for (auto j : adjacent[i])
-            {
-                fprintf(f, "\ts%d->s%d\n", i+1, j+1);
-            }
-        }
+    dump_ltl(numbered("ltl_before_transform.dot", number, settings), ltl.get());
+    dump_ltl(numbered("ltl_after_transform.dot", number, settings), translator.rewrite(ltl).get());
 
-        fprintf(f, "}\n");
-    }
+    std::string automaton_name = automaton_name_of(number, settings);
 
-    size_t card() const
-    {
-        return adjacent.size();
-    }
+    // neither the compositional translation nor the alternating engine has a LaTeX report
+    if (settings.compose)
+        return translate_compositional(compositional, ltl, parsing, automaton_name, settings) ? 0 : 2;
 
-private:
-    static void write_set_to(FILE *f, const index_vec_type &values)
-    {
-        fprintf(f, "%zu ", values.size());
-        for (size_t v : values)
-        {
-            fprintf(f, "%zu ", v);
-        }
-        fputs("\n", f);
-    }
+    if (settings.alternating)
+        return translate_alternating(alternating, ltl, parsing, automaton_name, settings) ? 0 : 2;
 
-    static void deduplicate(index_vec_type &values)
-    {
-        std::sort(values.begin(), values.end());
-        index_vec_type::iterator it =
-            std::unique(values.begin(), values.end());
-        values.erase(it, values.end());
-    }
-};
-
-bool iterate_mask(std::vector<bool>& atoms_mask, const int mask_size)
-{
-    if (atoms_mask.size() == 0)
-    {
-        for (int i = 0; i < mask_size; i++)
-            atoms_mask.push_back(false);
+    // the edges are never all in memory, so neither a report nor --stutter
+    if (settings.scratch)
+        return translate_external(translator, ltl, parsing, automaton_name, settings);
 
-        return true; // We can enter current iteration
-    }
+    if (settings.quiet)
+        return translate<NoReport>(translator, ltl, parsing, automaton_name, settings) ? 0 : 2;
 
-    bool IS = REVERSED_MASK; // Iterate from start
+    if (!settings.output)
+        return translate<LatexReport>(translator, ltl, parsing, automaton_name, settings, stdout, settings.compact) ? 0 : 2;
 
-    for (int i = IS ? 0 : (mask_size - 1); IS ? (i < mask_size) : (i >= 0); i += IS ? 1 : -1)
+    std::string tex_name = numbered(tex_name_of(settings.output), number, settings);
+    FILE *output = fopen(tex_name.c_str(), "w");
+    if (!output)
     {
-        if (!atoms_mask[i])
-        {
-            atoms_mask[i] = true;
-
-            for (int j = IS ? (i - 1) : (i + 1); IS ? (j >= 0) : (j < mask_size); j += IS ? -1 : 1)
-                atoms_mask[j] = false;
-
-            return true; // Found `false` in mask and iterated (010011 -> 010100), so can enter iteration
-        }
+        fprintf(stderr, "Can not open `%s`\n", tex_name.c_str());
+        return 1;
     }
 
-    return false; // All states already checked, we can't enter iteration
-}
-
-void get_atoms(const Ltl* ltl, std::vector<const Ltl*>& atoms)
-{
-    if (ltl->lhs())
-        get_atoms(ltl->lhs(), atoms);
+    bool translated = translate<LatexReport>(translator, ltl, parsing, automaton_name, settings, output, settings.compact);
+    fclose(output);
 
-    if (ltl->rhs())
-        get_atoms(ltl->rhs(), atoms);
+    if (!translated)
+        return 2;
 
-    if (ltl->kind() == Operator::X || ltl->kind() == Operator::ATOM)
-        add_if_not_presented(atoms, ltl);
-}
-
-void get_all(const Ltl* ltl, std::vector<const Ltl*>& all)
-{
-    if (ltl->lhs())
-        get_all(ltl->lhs(), all);
-
-    if (ltl->rhs())
-        get_all(ltl->rhs(), all);
-
-    add_if_not_presented(all, ltl);
+    pool.submit(tex_name, tex_name.substr(0, tex_name.size() - 4) + ".pdf");
+    return 0;
 }
 
-static std::vector<const Ltl*> transform_ltl(ref_ptr<Ltl>& ltl, FILE* output_file = nullptr)
+/// Translates every formula of the run from one tableau over the union of
+/// their closures, with neither report nor stuttering reduction. Returns the
+/// exit code of the run.
+static int translate_family(Translator &translator, const std::vector<std::string> &formulas, const Settings &settings)
 {
-    std::vector<const Ltl*> definitions;
-
-    if (output_file)
+    std::vector<ref_ptr<Ltl>> family;
+    for (size_t i = 0; i < formulas.size(); i++)
     {
-        fprintf(output_file, "\tПреобразуем исходную формулу\n");
-        fprintf(output_file, "\t$$\\varphi = %s", ltl->to_latex_string().c_str());
-    }
-    while (ltl->introduce_X())
-    {
-        if (output_file)
-            fprintf(output_file, " = \\text{/ Заносим X внутрь операторов /}$$\n\t$$= %s", ltl->to_latex_string().c_str());
-    }
-    if (ltl->substitute_R() && output_file)
-        fprintf(output_file, " = \\text{/ Выражаем R через U /}$$\n\t$$= %s", ltl->to_latex_string().c_str());
-    if (ltl->substitute_W() && output_file)
-        fprintf(output_file, " = \\text{/ Выражаем W через U и G /}$$\n\t$$= %s", ltl->to_latex_string().c_str());
-    if (ltl->substitute_G() && output_file)
-        fprintf(output_file, " = \\text{/ Выражаем G через F /}$$\n\t$$= %s", ltl->to_latex_string().c_str());
-    if (ltl->substitute_F() && output_file)
-        fprintf(output_file, " = \\text{/ Выражаем F через U /}$$\n\t$$= %s", ltl->to_latex_string().c_str());
-    if (output_file)
-    {
-        while (true)
+        ref_ptr<Ltl> ltl = translator.parse(formulas[i].c_str());
+        if (!ltl)
         {
-            std::vector<const Ltl*> just_announced;
-            bool found = ltl->find_nested_untils(definitions, just_announced);
-            if (found)
-                fprintf(output_file, " = $$\n\t$$= %s", ltl->to_latex_string(definitions, just_announced).c_str());
-            else
-            {
-                fprintf(output_file, " = $$\n\t$$= %s", ltl->to_latex_string(definitions).c_str());
-                break;
-            }
+            if (settings.batch)
+                fprintf(stderr, "Formula %zu: ", i + 1);
+            fprintf(stderr, "Parse error at position %zu: %s\n", translator.error().position, translator.error().message.c_str());
+            return 1;
         }
 
-        fprintf(output_file, "$$\n");
+        dump_ltl(numbered("ltl_before_transform.dot", i + 1, settings), ltl.get());
+        dump_ltl(numbered("ltl_after_transform.dot", i + 1, settings), translator.rewrite(ltl).get());
+        family.push_back(ltl);
     }
 
-    return definitions;
-}
-
-static node_ptr add_state(const ref_ptr<Ltl>& ltl, const std::vector<const Ltl*>& all, std::vector<Status> all_mask, std::vector<std::vector<Status>>& states)
-{
-    Status result = ltl->calculate(all, all_mask);
+    size_t allocations_before = allocations;
+    auto construction_start = stats_clock::now();
+    std::vector<std::unique_ptr<Automaton>> automata = translator.translate_family(family);
+    double micros = std::chrono::duration<double, std::micro>(stats_clock::now() - construction_start).count();
 
-    node_ptr current(new Node(all_mask));
-
-    int unknown_until_idx = -1;
-    for (int i = 0; i < all.size(); i++)
+    if (settings.stats)
     {
-        if (all_mask[i] == Status::UNKNOWN)
-        {
-            unknown_until_idx = i;
-            break;
-        }
-    }
+        Stats report;
+        report.micros[STATES] = micros;
+        report.states = translator.budget_status().states;
+        report.edges = translator.budget_status().edges;
+        report.allocations = allocations - allocations_before;
+        report.exceeded = translator.budget_status().exceeded;
 
-    if (unknown_until_idx >= 0)
-    {
-        all_mask[unknown_until_idx] = Status::FALSE;
-        current->set_first(add_state(ltl, all, all_mask, states));
-        all_mask[unknown_until_idx] = Status::TRUE;
-        current->set_second(add_state(ltl, all, all_mask, states));
+        // one line for the whole family
+        std::string names;
+        for (const std::string &formula : formulas)
+            names += (names.empty() ? "" : "; ") + formula;
+        report.write_json(stderr, names.c_str());
     }
 
-    else
-        states.push_back(all_mask);
-
-    return current;
-}
-
-std::string get_edge_restrictions(const std::vector<const Ltl*>& all, const std::vector<Status>& state, const std::vector<const Ltl *> definitions, const Ltl* initial_ltl)
-{
-    std::string restrictions;
-
-    for (auto subltl : all)
+    if (automata.empty())
     {
-        switch (subltl->kind())
-        {
-            case Operator::X:
-                if (not restrictions.empty())
-                    restrictions.append(" \\AND ");
-                restrictions.append(subltl->lhs()->to_latex_string(definitions, std::vector<const Ltl*>(), initial_ltl));
-                restrictions.append(state[find_if_presented(all, subltl)] == Status::TRUE ? " \\in " : " \\notin ");
-                restrictions.append("s'");
-                break;
-
-            case Operator::U:
-                if (state[find_if_presented(all, subltl->lhs())] == Status::TRUE &&
-                    state[find_if_presented(all, subltl->rhs())] == Status::FALSE)
-                {
-                    if (not restrictions.empty())
-                        restrictions.append(" \\AND ");
-                    restrictions.append(subltl->to_latex_string(definitions, std::vector<const Ltl*>(), initial_ltl));
-                    restrictions.append(state[find_if_presented(all, subltl)] == Status::TRUE ? " \\in " : " \\notin ");
-                    restrictions.append("s'");
-                }
-                break;
-        }
+        write_budget_status(translator.budget_status());
+        return 2;
     }
 
-    return restrictions;
-}
-
-static bool check_edge_rules(const std::vector<const Ltl*>& all, const std::vector<std::vector<Status>>& states, const int from, const int to)
-{
-    for (auto a : all)
-    {
-        if (a->kind() == Operator::U)
-        {
-            int u_idx = find_if_presented(all, a);
-            int u_lhs_idx = find_if_presented(all, a->lhs());
-            int u_rhs_idx = find_if_presented(all, a->rhs());
-
-            if (!(
-                (states[from][u_idx] == Status::TRUE && states[from][u_rhs_idx] == Status::TRUE) ||  // p U q === true, q === true -> any succesor possible
-                (states[from][u_idx] == Status::FALSE && states[from][u_lhs_idx] == Status::FALSE && states[from][u_rhs_idx] == Status::FALSE) ||  // if p U q === false, and p, q === 0 -> any succesor possible
-                (states[from][u_lhs_idx] == Status::TRUE && states[from][u_rhs_idx] == Status::FALSE && states[from][u_idx] == states[to][u_idx])  // if p === 1, q === 0 -> successor must have p U q same as prdecessor
-            ))
-                return false;
-        }
-        else if (a->kind() == Operator::X)
-        {
-            int x_idx = find_if_presented(all, a);
-            int x_var_idx = find_if_presented(all, a->lhs());
-
-            if (!(
-                states[from][x_idx] == states[to][x_var_idx]
-            ))
-                return false;
-        }
-    }
+    for (size_t i = 0; i < automata.size(); i++)
+        write_automaton(automaton_name_of(i + 1, settings), *automata[i], settings);
 
-    return true;
+    return 0;
 }
 
-void print_table_line(FILE* dst, const node_ptr& node, const std::vector<const Ltl*>& all, const std::vector<const Ltl *> definitions, const Ltl* initial_ltl, int& states_counter, int columns_count, int column = 0, bool fill_start = false, const Node<std::vector<Status>>* parent = nullptr)
+/// Checks `kripke` against one formula of the run instead of translating it.
+/// Returns 3 if the formula is violated.
+static int check_formula(Translator &translator, const Kripke &kripke, const char *formula, size_t number, const Settings &settings)
 {
-    if (fill_start)
-    {
-        for (int i = 0; i < column; i++)
-            fprintf(dst, "&");
-    }
-
-    std::string truth_list;
+    if (settings.batch)
+        printf("Formula %zu: ", number);
 
-    for (int i = 0; i < all.size(); i++)
+    ref_ptr<Ltl> ltl = translator.parse(formula);
+    if (!ltl)
     {
-        if (node->data[i] == Status::TRUE && (!COMPACT_TABLE || !parent || parent->data[i] != Status::TRUE))
-        {
-            if (not truth_list.empty())
-                truth_list.append(", ");
-
-            truth_list.append(all[i]->to_latex_string(definitions, std::vector<const Ltl*>(), initial_ltl));
-        }
+        fflush(stdout);
+        fprintf(stderr, "Parse error at position %zu: %s\n", translator.error().position, translator.error().message.c_str());
+        return 1;
     }
 
-    if (truth_list.empty())
-        truth_list.append("\\varnothing");
-
-    if (COMPACT_TABLE && parent)
-        truth_list = "+ " + truth_list;
-
-    if (node->first || node->second)
-        fprintf(dst, "\\multirow{%d}{*}{$%s$}", node->leafs_count(), truth_list.c_str());
-    else
-        fprintf(dst, "\\multirow{%d}{*}{$\\mathbf{s_{%d}}: %s$}", node->leafs_count(), states_counter++, truth_list.c_str());
-
-    if (node->first)
+    ModelChecker checker(translator, kripke);
+    CheckResult result;
+    if (!checker.check(ltl, result))
     {
-        fprintf(dst, "&");
-        print_table_line(dst, node->first, all, definitions, initial_ltl, states_counter, columns_count, column+1, false, node.get());
+        fflush(stdout);
+        write_budget_status(translator.budget_status());
+        return 2;
     }
 
-    else
+    if (result.holds)
     {
-        for (int i = column; i < columns_count - 1; i++)
-            fprintf(dst, "&");
-        fprintf(dst, "\\\\\n");
+        printf("holds (%zu product states)\n", result.product_states);
+        return 0;
     }
 
-    if (node->second)
-        print_table_line(dst, node->second, all, definitions, initial_ltl, states_counter, columns_count, column+1, true, node.get());
+    printf("violated (%zu product states)\n  prefix:", result.product_states);
+    for (size_t state : result.prefix)
+        printf(" %zu", state);
+    printf("\n  cycle:");
+    for (size_t state : result.cycle)
+        printf(" %zu", state);
+    printf("\n");
 
-    fprintf(dst, "\\cline{%d-%d}", column + 1, columns_count);
+    return 3;
 }
 
-static std::unique_ptr<Automaton> run_ltl_to_buchi(const char *text, FILE* output_file = nullptr)
+int main(int argc, char *argv[])
 {
-    if (output_file)
-        write_preamble(output_file);
+    Settings settings;
+    Translator::Options options;
+    std::vector<std::string> formulas;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
 
-    Parser parser;
-    ref_ptr<Ltl> ltl = parser.parse(text);
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            settings.output = argv[++i];
 
-    FILE* f = fopen("ltl_before_transform.dot", "w");
-    ltl->dump_to(f);
-    fclose(f);
+        else if (!strcmp(argv[i], "--reverse-mask") || !strcmp(argv[i], "-r"))
+            options.reversed_mask = true;
 
-    auto definitions = transform_ltl(ltl, output_file);
+        else if (!strcmp(argv[i], "--compact") || !strcmp(argv[i], "-c"))
+            settings.compact = true;
 
-    f = fopen("ltl_after_transform.dot", "w");
-    ltl->dump_to(f);
-    fclose(f);
+        else if (!strcmp(argv[i], "--quiet") || !strcmp(argv[i], "-q"))
+            settings.quiet = true;
 
-    std::vector<const Ltl*> atoms;
-    std::vector<bool> atoms_mask;
-    std::vector<const Ltl*> all;
-    std::vector<std::vector<Status>> states;
+        else if (!strcmp(argv[i], "--stutter"))
+            settings.stutter = true;
 
-    get_atoms(ltl.get(), atoms);
-    get_all(ltl.get(), all);
+        else if (!strcmp(argv[i], "--compose"))
+            settings.compose = true;
 
-    if (output_file)
-    {
-        fprintf(output_file, "\n\tЗапишем таблицу истинности для независимых подформул: ");
-        for (int i = 0; i < atoms.size(); i++)
-        {
-            fprintf(output_file, "$%s$", atoms[i]->to_latex_string().c_str());
-            if (i == atoms.size() - 1)
-                fprintf(output_file, "\n");
-            else
-                fprintf(output_file, ", ");
-        }
-    }
+        else if (!strcmp(argv[i], "--shared"))
+            settings.shared = true;
 
-    std::vector<node_ptr> table_states;
+        else if (!strcmp(argv[i], "--compress"))
+            settings.compress = options.compress = true;
 
-    int states_counter = 1;
-    while (iterate_mask(atoms_mask, atoms.size()))
-    {
-        std::vector<Status> all_mask;
-        for (auto cur_ltl : all)
-        {
-            int found = find_if_presented(atoms, cur_ltl);
-            if (found >= 0)
-                all_mask.push_back(atoms_mask[found] ? Status::TRUE : Status::FALSE);
-            else
-                all_mask.push_back(Status::UNKNOWN);
-        }
+        else if (!strcmp(argv[i], "--external") && i + 1 < argc)
+            settings.scratch = argv[++i];
 
-        auto split_tree = add_state(ltl, all, all_mask, states);
-        table_states.push_back(split_tree);
-    }
+        else if (!strcmp(argv[i], "--count"))
+            settings.count = true;
 
-    if (output_file)
-    {
-        int max_depth = 0;
-        for (auto tree : table_states)
-        {
-            int depth = tree->depth() + atoms.size();
-            if (depth > max_depth)
-                max_depth = depth;
-        }
+        else if (!strcmp(argv[i], "--stats"))
+            settings.stats = true;
 
-        fprintf(output_file, "\t\\begin{table}[h!]\n\t\t\\begin{tabular}{|");
-        for (int i = 0; i < atoms.size(); i++)
-            fprintf(output_file, "c|");
-        for (int i = atoms.size(); i < max_depth; i++)
-            fprintf(output_file, "l|");
+        else if (!strcmp(argv[i], "--max-seconds") && i + 1 < argc)
+            options.budget.seconds = atof(argv[++i]);
 
-        fprintf(output_file, "}\n\t\t\t\\hline\n\t\t\t");
-        for (int i = 0; i < max_depth; i++)
-        {
-            if (i < atoms.size())
-                fprintf(output_file, "$%s$", atoms[i]->to_latex_string().c_str());
-            else
-                fprintf(output_file, " ");
-            if (i != max_depth - 1)
-                fprintf(output_file, "&");
-        }
-        fprintf(output_file, "\\\\\n\t\t\t\\hline\n");
+        else if (!strcmp(argv[i], "--max-states") && i + 1 < argc)
+            options.budget.states = strtoull(argv[++i], nullptr, 10);
 
-        std::vector<bool> new_atoms_mask;
-        int spilt_tree_idx = 0;
-        while (iterate_mask(new_atoms_mask, atoms.size()))
-        {
-            auto split_tree = table_states[spilt_tree_idx++];
+        else if (!strcmp(argv[i], "--max-edges") && i + 1 < argc)
+            options.budget.edges = strtoull(argv[++i], nullptr, 10);
 
-            for (auto atom_state : new_atoms_mask)
-                fprintf(output_file, "\\multirow{%d}{*}{%d} & ", split_tree->leafs_count(), atom_state ? 1 : 0);
+        else if (!strcmp(argv[i], "--max-bytes") && i + 1 < argc)
+            options.budget.bytes = strtoull(argv[++i], nullptr, 10);
 
-            print_table_line(output_file, split_tree, all, definitions, ltl.get(), states_counter, max_depth, atoms.size());
-
-            fprintf(output_file, "\\hline\n");
+        else if (!strcmp(argv[i], "--engine") && i + 1 < argc)
+        {
+            const char *engine = argv[++i];
+            if (strcmp(engine, "tableau") && strcmp(engine, "vwaa"))
+            {
+                fprintf(stderr, "Unknown engine `%s`, expected tableau or vwaa\n", engine);
+                return 1;
+            }
+            settings.alternating = !strcmp(engine, "vwaa");
         }
 
-        fprintf(output_file, "\t\t\\end{tabular}\n\t\\end{table}\n");
-    }
-
-    std::unique_ptr<Automaton> maton(new Automaton(states.size()));
+        else if (!strcmp(argv[i], "--model") && i + 1 < argc)
+            settings.model = argv[++i];
 
-    if (output_file)
-    {
-        fprintf(output_file, "\n\tНачальные состояния:\n\n\t$$\n\t\tI = \\{s: \\varphi \\in s\\} = \\{");
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            jobs = atol(argv[++i]);
 
-        bool first_iter = true;
-        int c = 1;
-        for (int i = 0; i < states.size(); i++)
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
         {
-            if (states[i].back() == Status::TRUE)
+            // one formula per line, empty lines and lines starting with # are skipped
+            FILE *f = fopen(argv[++i], "r");
+            if (!f)
             {
-                maton->mark_init(i);
-                if (not first_iter)
-                    fprintf(output_file, ", ");
-                first_iter = false;
-                fprintf(output_file, "s_{%d}", i + 1);
+                fprintf(stderr, "Can not open `%s`\n", argv[i]);
+                return 1;
             }
-        }
-
-        fprintf(output_file, "\\}\n\t$$\n");
-    }
 
-    else
-    {
-        for (int i = 0; i < states.size(); i++)
-        {
-            if (states[i].back() == Status::TRUE)
-                maton->mark_init(i);
-        }
-    }
+            char *line = nullptr;
+            size_t capacity = 0;
+            ssize_t length;
+            while ((length = getline(&line, &capacity, f)) >= 0)
+            {
+                while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+                    line[--length] = '\0';
+                if (length > 0 && line[0] != '#')
+                    formulas.push_back(line);
+            }
 
-    if (output_file)
-    {
-        int U_count = 0;
-        for (auto l : all)
-        {
-            if (l->kind() == Operator::U)
-                U_count++;
+            free(line);
+            fclose(f);
         }
 
-        fprintf(output_file, "\n\tВ формуле имеется %d операций $\\UNTIL$, таким образом"
-                " будет %d множеств допускающих состояний: \n", 
-                U_count, U_count);
+        else
+            formulas.push_back(argv[i]);
     }
 
-    int set_no = 0;
-    for (auto l : all)
+    if (formulas.empty())
     {
-        if (l->kind() == Operator::U || 
-            l->kind() == Operator::F ||
-            l->kind() == Operator::G ||
-            l->kind() == Operator::R ||
-            l->kind() == Operator::W)
-        {
-            auto right = (l->kind() == Operator::F || l->kind() == Operator::G) ? l->lhs() : l->rhs();
-
-            if (output_file)
-                fprintf(output_file, "\n\t$$\n\t\tF_{%s} = \\{s: %s \\in s \\OR %s \\notin s \\} = \\{", 
-                        l->to_latex_string(definitions, std::vector<const Ltl*>(), ltl.get()).c_str(), 
-                        right->to_latex_string(definitions, std::vector<const Ltl*>(), ltl.get()).c_str(), 
-                        l->to_latex_string(definitions, std::vector<const Ltl*>(), ltl.get()).c_str());
-
-            int u_idx = find_if_presented(all, l);
-            int u_rhs_idx = find_if_presented(all, right);
-
-            bool first_iter = true;
-            for (int i = 0; i < states.size(); i++)
-            {
-                if (states[i][u_idx] == states[i][u_rhs_idx])
-                {
-                    maton->mark_accept(set_no, i);
-
-                    if (output_file)
-                    {
-                        if (!first_iter)
-                            fprintf(output_file, ", ");
-                        first_iter = false;
-                        fprintf(output_file, "s_{%d}", i + 1);
-                    }
-                }
-            }
-
-            if (output_file)
-                fprintf(output_file, "\\}\n\t$$\n");
-
-            set_no++;
-        }
+        fprintf(stderr, "Usage: %s [-q] [-r] [-c] [--stats] [--stutter] [--compose] [--shared] [--compress] [--external dir] [--count] [--max-seconds S] [--max-states N] [--max-edges N] [--max-bytes N] [-o report.pdf] [-j jobs] [--batch file] [--engine tableau|vwaa] [--model kripke.txt] formula...\n", argv[0]);
+        return 1;
     }
 
-    if (output_file)
-        fprintf(output_file, "\n\tВычислим переходы между узлами:\n\n");
+    settings.batch = formulas.size() > 1;
 
-    std::vector<std::string> edge_rules;
-    std::vector<std::string> edge_definitions;
+    Translator translator(options);
 
-    for (int from = 0; from < states.size(); from++)
+    if (settings.model)
     {
-        if (output_file)
+        Kripke kripke;
+        if (!kripke.load(settings.model))
         {
-            std::string atoms_truth;
-            for (int i = 0; i < atoms.size(); i++)
-            {
-                int atom_idx = find_if_presented(all, atoms[i]);
-                if (atom_idx >= 0 and states[from][atom_idx] == Status::TRUE)
-                {
-                    if (not atoms_truth.empty())
-                        atoms_truth.append(", ");
-                    atoms_truth.append(atoms[i]->to_latex_string());
-                }
-            }
-
-            if (atoms_truth.empty())
-                atoms_truth.append("\\varnothing");
-            else
-                atoms_truth = "\\{" + atoms_truth + "\\}";
-
-            auto rules = get_edge_restrictions(all, states[from], definitions, ltl.get());
-
-            int same_rules_idx = -1;
-            for (int i = 0; i < edge_rules.size(); i++)
-            {
-                if (edge_rules[i] == rules)
-                {
-                    same_rules_idx = i;
-                    break;
-                }
-            }
-
-            fprintf(output_file, "\t$$\n\t\t\\delta(s_{%d}, %s) = ", from+1, atoms_truth.c_str());
-
-            if (same_rules_idx == -1)
-            {
-                fprintf(output_file, "\\{s': %s\\} = \\{", rules.c_str());
-                edge_rules.push_back(rules);
-            }
-            else
-            {
-                fprintf(output_file, "%s = \\{", edge_definitions[same_rules_idx].c_str());
-                edge_rules.push_back("");
-            }
-
-            edge_definitions.push_back("\\delta(s_{" + std::to_string(from + 1) + "}, " + atoms_truth + ")");
+            fprintf(stderr, "%s:%zu: %s\n", settings.model, kripke.error().line, kripke.error().message.c_str());
+            return 1;
         }
 
-        bool first_iter = true;
-        for (int to = 0; to < states.size(); to++)
+        int exit_code = 0;
+        for (size_t i = 0; i < formulas.size(); i++)
         {
-            if (check_edge_rules(all, states, from, to))
-            {
-                maton->add_transition(from, to);
-                if (output_file)
-                {
-                    if (not first_iter)
-                        fprintf(output_file, ", ");
-                    first_iter = false;
-                    fprintf(output_file, "s_{%d}", to+1);
-                }
-            }
+            int code = check_formula(translator, kripke, formulas[i].c_str(), i + 1, settings);
+            if (!exit_code)
+                exit_code = code;
         }
 
-        if (output_file)
-            fprintf(output_file, "\\}\n\t$$\n");
+        return exit_code;
     }
 
-    FILE* automaton_dump_file = fopen("automaton.dot", "w");
-    maton->write_graph_to(automaton_dump_file);
-    fclose(automaton_dump_file);
+    if (settings.shared)
+        return translate_family(translator, formulas, settings);
 
-    if (output_file)
-        write_ending(output_file);
-    
-    return maton;
-}
+    AlternatingTranslator alternating(options.budget);
 
-int main(int argc, char *argv[])
-{
-    int ltl_idx = 0;
-    int output_file_idx = 0;
+    CompositionalTranslator::Options compositional_options;
+    compositional_options.translator = options;
+    compositional_options.alternating = settings.alternating;
+    compositional_options.stutter = settings.stutter;
+    compositional_options.jobs = jobs > 0 ? jobs : 1;
+    CompositionalTranslator compositional(compositional_options);
 
-    for (int i = 1; i < argc; i++)
-    {
-        if (!strcmp(argv[i], "-o"))
-            output_file_idx = ++i;
-
-        else if (!strcmp(argv[i], "--reverse-mask") || !strcmp(argv[i], "-r"))
-            REVERSED_MASK = true;
-
-        else if (!strcmp(argv[i], "--compact") || !strcmp(argv[i], "-c"))
-            COMPACT_TABLE = true;
-
-        else
-            ltl_idx = i;
-    }
-
-    FILE* output = stdout;
-    char* tex_name = nullptr;
+    PdfPool pool(jobs > 0 ? jobs : 1);
+    int exit_code = 0;
 
-    if (output_file_idx != 0)
+    for (size_t i = 0; i < formulas.size(); i++)
     {
-        tex_name = new char[strlen(argv[output_file_idx]) + 1 + 4];
-        strcpy(tex_name, argv[output_file_idx]);
-
-        char* last_dot = strrchr(tex_name, '.');
-        if (last_dot == nullptr)
-            strcat(tex_name, ".tex");
-
-        else if (!strcmp(last_dot, ".pdf"))
-            strcpy(last_dot, ".tex");
-
-        else if (!strcmp(last_dot, ".tex"));
-
-        else
-            strcat(tex_name, ".tex");
-
-        output = fopen(tex_name, "w");
+        int code = translate_formula(translator, alternating, compositional, formulas[i].c_str(), i + 1, settings, pool);
+        if (!exit_code)
+            exit_code = code;
     }
 
-    auto buchi = run_ltl_to_buchi(argv[1], output);
-
-    if (output_file_idx != 0)
+    for (const PdfResult &result : pool.wait())
     {
-        fclose(output);
-
-        char* cmd = new char[strlen(tex_name) + sizeof("pdflatex ") + 1];
-        strcpy(cmd, "pdflatex ");
-        strcat(cmd, tex_name);
-
-        int res = system(cmd);
+        if (result.status == PdfResult::NOT_FOUND)
+            printf("Can not find pdflatex, result exported to `%s` but not compiled\n", result.tex_name.c_str());
 
-        if (res == -1)
-            printf("Can not find pdflatex, result exported to `%s` but not compiled\n", tex_name);
+        else if (result.status == PdfResult::FAILED && !result.log_name.empty())
+            printf("Error occured while compiling `%s`, see `%s`\n", result.tex_name.c_str(), result.log_name.c_str());
 
-        else if (res != 0)
-            printf("Error occured while compiling `%s`\n", tex_name);
-
-        else
-        {
-            char* extension = strrchr(tex_name, '.');
-            remove(tex_name);
-            strcpy(extension, ".aux");
-            remove(tex_name);
-            strcpy(extension, ".log");
-            remove(tex_name);
-            strcpy(extension, ".out");
-            remove(tex_name);
-        }
-
-        delete[] tex_name;
-        delete[] cmd;
+        else if (result.status == PdfResult::FAILED)
+            printf("Error occured while compiling `%s`\n", result.tex_name.c_str());
     }
 
-    return 0;
+    return exit_code;
 }
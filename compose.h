@@ -0,0 +1,593 @@
+#pragma once
+
+#include "alternating.h"
+#include "automaton.h"
+#include "ltl.h"
+#include "stutter.h"
+#include "translator.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/// Top-level conjuncts of `ltl` from left to right; `ltl` itself if it is no
+/// conjunction. Equal conjuncts are kept once.
+inline std::vector<const Ltl*> conjuncts(const Ltl *ltl)
+{
+    std::vector<const Ltl*> found;
+    StructuralIds ids;
+    std::vector<bool> kept;                 // by structural id
+    std::unordered_set<const Ltl*> seen;    // a shared conjunct is looked at once
+    std::vector<const Ltl*> stack = {ltl};
+
+    while (!stack.empty())
+    {
+        const Ltl *top = stack.back();
+        stack.pop_back();
+
+        if (!seen.insert(top).second)
+            continue;
+
+        if (top->kind() == Operator::AND)
+        {
+            stack.push_back(top->rhs());
+            stack.push_back(top->lhs());
+            continue;
+        }
+
+        size_t id = ids.id_of(top);
+        if (id >= kept.size())
+            kept.resize(id + 1);
+        if (!kept[id])
+            found.push_back(top);
+        kept[id] = true;
+    }
+
+    return found;
+}
+
+/// Automaton of the same language as `maton` without the states no accepting
+/// run goes through: those not reachable from an initial state and those
+/// from which no cycle through every accepting set can be reached. `origin`
+/// receives the state of `maton` every state comes from.
+inline std::unique_ptr<Automaton> prune_useless(const Automaton &maton, std::vector<size_t> &origin)
+{
+    size_t card = maton.card();
+    size_t sets = maton.accept_sets_count();
+
+    std::vector<std::vector<size_t>> sets_of(card);
+    for (size_t set = 0; set < sets; set++)
+    {
+        for (size_t state : maton.accepting_set(set))
+            sets_of[state].push_back(set);
+    }
+
+    // Components of Tarjan over the reachable states; `number` is the order
+    // of the search, 0 if not reached yet
+    const size_t NONE = SIZE_MAX;
+    std::vector<size_t> number(card, 0);
+    std::vector<size_t> low(card, 0);
+    std::vector<size_t> component(card, NONE);
+    std::vector<bool> accepting_component;
+    std::vector<size_t> live;
+    std::vector<std::pair<size_t, Successors::iterator>> frames;     // state and its next successor
+    size_t visited = 0;
+
+    for (size_t root : maton.initial_states())
+    {
+        if (number[root])
+            continue;
+
+        number[root] = low[root] = ++visited;
+        live.push_back(root);
+        frames.push_back({root, maton.successors(root).begin()});
+
+        while (!frames.empty())
+        {
+            size_t state = frames.back().first;
+            Successors next = maton.successors(state);
+
+            if (frames.back().second != next.end())
+            {
+                size_t to = *frames.back().second;
+                ++frames.back().second;
+                if (!number[to])
+                {
+                    number[to] = low[to] = ++visited;
+                    live.push_back(to);
+                    frames.push_back({to, maton.successors(to).begin()});
+                }
+                else if (component[to] == NONE)
+                    low[state] = std::min(low[state], number[to]);
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().first] = std::min(low[frames.back().first], low[state]);
+
+            if (low[state] != number[state])
+                continue;
+
+            size_t id = accepting_component.size();
+            std::vector<bool> covered(sets, false);
+            size_t members = 0;
+            size_t x;
+            do
+            {
+                x = live.back();
+                live.pop_back();
+                component[x] = id;
+                members++;
+                for (size_t set : sets_of[x])
+                    covered[set] = true;
+            } while (x != state);
+
+            // a single state is a cycle only if it loops
+            bool cycle = members > 1 || std::find(next.begin(), next.end(), state) != next.end();
+            accepting_component.push_back(cycle && (size_t) std::count(covered.begin(), covered.end(), true) == sets);
+        }
+    }
+
+    std::vector<std::vector<size_t>> predecessors(card);
+    std::vector<size_t> stack;
+    std::vector<bool> useful(card, false);
+    for (size_t state = 0; state < card; state++)
+    {
+        if (!number[state])
+            continue;
+
+        for (size_t to : maton.successors(state))
+            predecessors[to].push_back(state);
+
+        if (accepting_component[component[state]])
+        {
+            useful[state] = true;
+            stack.push_back(state);
+        }
+    }
+
+    while (!stack.empty())
+    {
+        size_t state = stack.back();
+        stack.pop_back();
+
+        for (size_t from : predecessors[state])
+        {
+            if (!useful[from])
+            {
+                useful[from] = true;
+                stack.push_back(from);
+            }
+        }
+    }
+
+    std::vector<size_t> index(card, NONE);
+    origin.clear();
+    for (size_t state = 0; state < card; state++)
+    {
+        if (useful[state])
+        {
+            index[state] = origin.size();
+            origin.push_back(state);
+        }
+    }
+
+    std::unique_ptr<Automaton> pruned(new Automaton(origin.size()));
+    pruned->reserve_accept_sets(sets);
+    if (maton.is_stutter_invariant())
+        pruned->mark_stutter_invariant();
+
+    for (size_t state : maton.initial_states())
+    {
+        if (useful[state])
+            pruned->mark_init(index[state]);
+    }
+
+    for (size_t state : origin)
+    {
+        for (size_t to : maton.successors(state))
+        {
+            if (useful[to])
+                pruned->add_transition(index[state], index[to]);
+        }
+
+        for (size_t set : sets_of[state])
+            pruned->mark_accept(set, index[state]);
+
+        if (!maton.label(state).empty())
+            pruned->set_label(index[state], maton.label(state));
+    }
+
+    return pruned;
+}
+
+/// Translates a conjunction conjunct by conjunct. Every top-level conjunct
+/// is translated on its own, by a pool of threads with one translator each,
+/// and reduced; the automaton of the conjunction is then the synchronous
+/// product of the reduced ones, explored from its initial states so that
+/// only the reachable tuples whose labels agree are built. A tuple is in the
+/// accepting sets of every factor, those of the first factor coming first,
+/// and is labelled with the literals it reads.
+class CompositionalTranslator
+{
+public:
+    using Cube = AlternatingTranslator::Cube;
+
+    struct Options
+    {
+        Translator::Options translator;
+        bool alternating = false;   // translate the conjuncts through alternating automata
+        bool stutter = false;       // reduce_stuttering the conjuncts without X
+        size_t jobs = 1;            // threads translating the conjuncts
+    };
+
+    explicit CompositionalTranslator(Options options) : options(options) { }
+
+    CompositionalTranslator(const CompositionalTranslator &) = delete;
+    CompositionalTranslator &operator=(const CompositionalTranslator &) = delete;
+
+    /// Returns an empty pointer if a conjunct or the product exceeds the
+    /// budget, see budget_status()
+    std::unique_ptr<Automaton> translate(const ref_ptr<Ltl> &formula)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+        clear();
+
+        std::vector<const Ltl*> found = conjuncts(formula.get());
+        factors.resize(found.size());
+        for (size_t i = 0; i < found.size(); i++)
+            factors[i].conjunct = found[i];
+
+        translate_factors();
+
+        for (const Factor &factor : factors)
+        {
+            if (!factor.maton)
+            {
+                status = factor.status;
+                return nullptr;
+            }
+        }
+
+        share_atoms();
+        return build_product();
+    }
+
+    const BudgetStatus &budget_status() const
+    {
+        return status;
+    }
+
+    /// States of every reduced conjunct of the last translation
+    std::vector<size_t> factor_sizes() const
+    {
+        std::vector<size_t> sizes;
+        for (const Factor &factor : factors)
+            sizes.push_back(factor.maton ? factor.maton->card() : 0);
+        return sizes;
+    }
+
+    /// Class of the label of every state of the last automaton, the states
+    /// of one class read the same letters
+    std::vector<size_t> state_letters() const
+    {
+        std::map<Cube, size_t> classes;
+        std::vector<size_t> letters;
+        for (const Cube &cube : cubes)
+            letters.push_back(classes.emplace(cube, classes.size()).first->second);
+        return letters;
+    }
+
+private:
+    /// Reduced automaton of one conjunct, with the literals every state reads
+    struct Factor
+    {
+        const Ltl *conjunct;                // of the formula, only read by the threads
+        std::unique_ptr<Automaton> maton;
+        std::vector<Cube> cubes;
+        std::vector<std::string> names;     // atoms of the literals, by factor until share_atoms()
+        std::vector<std::vector<size_t>> sets_of;
+        BudgetStatus status;
+    };
+
+    void clear()
+    {
+        factors.clear();
+        names.clear();
+        tuples.clear();
+        cubes.clear();
+        tuple_ids.clear();
+        successors.clear();
+        pending.clear();
+    }
+
+    void translate_factors()
+    {
+        std::atomic<size_t> next(0);
+        auto work = [&]()
+        {
+            // the conjunct is copied, so that the formulas of a thread all
+            // come from its own factory
+            Translator translator(options.translator);
+            AlternatingTranslator alternating(options.translator.budget);
+
+            for (size_t i; (i = next.fetch_add(1)) < factors.size();)
+                translate_factor(translator, alternating, factors[i]);
+        };
+
+        size_t threads = std::min(std::max<size_t>(options.jobs, 1), factors.size());
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < threads; i++)
+            pool.emplace_back(work);
+
+        work();
+
+        for (std::thread &thread : pool)
+            thread.join();
+    }
+
+    void translate_factor(Translator &translator, AlternatingTranslator &alternating, Factor &factor) const
+    {
+        ref_ptr<Ltl> ltl = translator.factory().copy(factor.conjunct);
+        std::unique_ptr<Automaton> maton;
+        std::vector<size_t> letters;
+
+        if (options.alternating)
+        {
+            maton = alternating.translate(ltl);
+            factor.status = alternating.budget_status();
+            if (!maton)
+                return;
+
+            factor.names = alternating.atom_names();
+            for (size_t state = 0; state < maton->card(); state++)
+                factor.cubes.push_back(alternating.label(state));
+            letters = alternating.state_letters();
+        }
+        else
+        {
+            maton = translator.translate(ltl);
+            factor.status = translator.budget_status();
+            if (!maton)
+                return;
+
+            // X atoms are not read from the letter
+            const std::vector<const Ltl*> &atoms = translator.tableau_atoms();
+            std::vector<int> ids(atoms.size(), -1);
+            for (size_t i = 0; i < atoms.size(); i++)
+            {
+                if (atoms[i]->kind() == Operator::ATOM)
+                {
+                    ids[i] = factor.names.size();
+                    factor.names.push_back(atoms[i]->node_to_string());
+                }
+            }
+
+            for (size_t state = 0; state < maton->card(); state++)
+            {
+                Cube cube;
+                for (size_t i = 0; i < atoms.size(); i++)
+                {
+                    if (ids[i] >= 0)
+                        cube.push_back(2 * ids[i] + !translator.atom_value(state, i));
+                }
+                factor.cubes.push_back(cube);
+            }
+            letters = translator.state_letters();
+        }
+
+        std::vector<size_t> origin;
+        if (options.stutter && is_stutter_invariant(ltl.get()))
+        {
+            maton = reduce_stuttering(*maton, letters, &origin);
+            keep_cubes(factor, origin);
+        }
+
+        maton = prune_useless(*maton, origin);
+        keep_cubes(factor, origin);
+
+        factor.sets_of.assign(maton->card(), {});
+        for (size_t set = 0; set < maton->accept_sets_count(); set++)
+        {
+            for (size_t state : maton->accepting_set(set))
+                factor.sets_of[state].push_back(set);
+        }
+
+        factor.maton = std::move(maton);
+    }
+
+    /// The cubes of the states of `origin`, in its order
+    static void keep_cubes(Factor &factor, const std::vector<size_t> &origin)
+    {
+        std::vector<Cube> kept;
+        for (size_t state : origin)
+            kept.push_back(std::move(factor.cubes[state]));
+        factor.cubes.swap(kept);
+    }
+
+    /// Renumbers the literals of every factor over the atoms of all of them
+    void share_atoms()
+    {
+        std::unordered_map<std::string, int> ids;
+        for (Factor &factor : factors)
+        {
+            std::vector<int> global;
+            for (const std::string &name : factor.names)
+            {
+                auto it = ids.emplace(name, names.size()).first;
+                if ((size_t) it->second == names.size())
+                    names.push_back(name);
+                global.push_back(it->second);
+            }
+
+            for (Cube &cube : factor.cubes)
+            {
+                for (int &literal : cube)
+                    literal = 2 * global[literal / 2] + (literal & 1);
+                std::sort(cube.begin(), cube.end());
+            }
+        }
+    }
+
+    /// Calls `visit(tuple, cube)` for every choice of one state of every
+    /// factor among `choices` whose labels agree, with the literals they read
+    template<class F>
+    void for_each_compatible(const std::vector<Successors> &choices, F visit) const
+    {
+        size_t n = factors.size();
+        std::vector<size_t> tuple(n);
+        std::vector<Successors::iterator> next;
+        for (const Successors &choice : choices)
+            next.push_back(choice.begin());
+        std::vector<Cube> partial(n + 1);
+        size_t depth = 0;
+
+        while (true)
+        {
+            if (depth == n)
+            {
+                visit(tuple, partial[n]);
+                depth--;
+                continue;
+            }
+
+            if (next[depth] == choices[depth].end())
+            {
+                if (!depth)
+                    return;
+                depth--;
+                continue;
+            }
+
+            size_t state = *next[depth];
+            ++next[depth];
+            if (!AlternatingTranslator::conjoin(partial[depth], factors[depth].cubes[state], partial[depth + 1]))
+                continue;
+
+            tuple[depth++] = state;
+            if (depth < n)
+                next[depth] = choices[depth].begin();
+        }
+    }
+
+    /// Product state of `tuple`, numbered the first time it is seen
+    size_t state_of(const std::vector<size_t> &tuple, const Cube &cube)
+    {
+        auto it = tuple_ids.emplace(tuple, tuples.size()).first;
+        if (it->second == tuples.size())
+        {
+            tuples.push_back(tuple);
+            cubes.push_back(cube);
+            successors.emplace_back();
+            pending.push_back(it->second);
+        }
+        return it->second;
+    }
+
+    std::unique_ptr<Automaton> build_product()
+    {
+        std::vector<Successors> choices;
+        for (const Factor &factor : factors)
+            choices.emplace_back(factor.maton->initial_states());
+
+        std::vector<size_t> initial;
+        for_each_compatible(choices, [&](const std::vector<size_t> &tuple, const Cube &cube)
+        {
+            initial.push_back(state_of(tuple, cube));
+        });
+
+        size_t edges = 0;
+        while (!pending.empty())
+        {
+            size_t state = pending.front();
+            pending.pop_front();
+
+            for (size_t i = 0; i < factors.size(); i++)
+                choices[i] = factors[i].maton->successors(tuples[state][i]);
+
+            std::vector<size_t> row;
+            for_each_compatible(choices, [&](const std::vector<size_t> &tuple, const Cube &cube)
+            {
+                row.push_back(state_of(tuple, cube));
+            });
+
+            edges += row.size();
+            successors[state].swap(row);
+
+            if (exceeds_budget(edges))
+                return nullptr;
+        }
+
+        std::vector<size_t> offsets;
+        size_t sets = 0;
+        bool stutter_invariant = true;
+        for (const Factor &factor : factors)
+        {
+            offsets.push_back(sets);
+            sets += factor.maton->accept_sets_count();
+            stutter_invariant = stutter_invariant && factor.maton->is_stutter_invariant();
+        }
+
+        std::unique_ptr<Automaton> maton(new Automaton(tuples.size()));
+        maton->reserve_accept_sets(sets);
+        if (stutter_invariant)
+            maton->mark_stutter_invariant();
+
+        for (size_t state : initial)
+            maton->mark_init(state);
+
+        for (size_t state = 0; state < tuples.size(); state++)
+        {
+            for (size_t to : successors[state])
+                maton->add_transition(state, to);
+
+            for (size_t i = 0; i < factors.size(); i++)
+            {
+                for (size_t set : factors[i].sets_of[tuples[state][i]])
+                    maton->mark_accept(offsets[i] + set, state);
+            }
+
+            maton->set_label(state, AlternatingTranslator::text_of(cubes[state], names));
+        }
+
+        maton->finalize();
+        return maton;
+    }
+
+    bool exceeds_budget(size_t edges)
+    {
+        status.states = tuples.size();
+        status.edges = edges;
+        status.bytes = tuples.size() * (factors.size() + 1) * sizeof(size_t) + edges * sizeof(size_t);
+        status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return options.translator.budget.exceeded_by(status);
+    }
+
+    Options options;
+    BudgetStatus status;
+    std::chrono::steady_clock::time_point start;
+
+    std::vector<Factor> factors;
+    std::vector<std::string> names;     // atoms of the literals of every factor
+
+    std::vector<std::vector<size_t>> tuples;    // state of every factor, by product state
+    std::vector<Cube> cubes;
+    std::map<std::vector<size_t>, size_t> tuple_ids;
+    std::vector<std::vector<size_t>> successors;
+    std::deque<size_t> pending;
+};
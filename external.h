@@ -0,0 +1,298 @@
+#pragma once
+
+#include "automaton.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+/// Automaton written to a file as its transitions are added, for automata
+/// whose edges do not fit in memory. It takes the transitions the way an
+/// Automaton does, row by row, but keeps them in a batch of at most
+/// `run_edges` edges: a full batch is sorted and written to the scratch
+/// directory as a run, and write_to merges the runs into the binary format
+/// of GbaWriter, dropping duplicate edges on the way. Only
+/// the row of every state and the initial and accepting states stay in
+/// memory.
+class AutomatonWriter
+{
+    using Edge = std::pair<size_t, size_t>;     // row and successor
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    // at most this many runs are open, more are merged into one first
+    static constexpr size_t MAX_RUNS = 64;
+
+    /// A run read back in chunks
+    struct Reader
+    {
+        FILE *file;
+        std::vector<Edge> chunk;
+        size_t next = 0;
+
+        bool fill()
+        {
+            chunk.resize(4096);
+            chunk.resize(fread(chunk.data(), sizeof(Edge), chunk.size(), file));
+            next = 0;
+            return !chunk.empty();
+        }
+    };
+
+public:
+    AutomatonWriter(size_t card, size_t sets, std::string scratch, size_t run_edges)
+        : row_of(card, NONE), accepting(sets), scratch(std::move(scratch)), run_edges(std::max<size_t>(run_edges, 1)) { }
+
+    AutomatonWriter(const AutomatonWriter &) = delete;
+    AutomatonWriter &operator=(const AutomatonWriter &) = delete;
+
+    /// The runs are unlinked as soon as they are created, closing them is
+    /// enough to free their space
+    ~AutomatonWriter()
+    {
+        for (FILE *run : runs)
+            fclose(run);
+    }
+
+    size_t card() const
+    {
+        return row_of.size();
+    }
+
+    void mark_init(size_t state)
+    {
+        initial.push_back(state);
+    }
+
+    void mark_accept(size_t set, size_t state)
+    {
+        accepting[set].push_back(state);
+    }
+
+    /// A state which shares the successors of another one gets no more
+    void add_transition(size_t src, size_t dst)
+    {
+        if (row_of[src] == NONE)
+            row_of[src] = rows++;
+
+        batch.push_back({row_of[src], dst});
+        if (batch.size() >= run_edges)
+            spill();
+    }
+
+    /// `state` gets the successors of `other`, which already has all of them
+    void share_successors(size_t state, size_t other)
+    {
+        if (row_of[other] == NONE)
+            row_of[other] = rows++;
+        row_of[state] = row_of[other];
+    }
+
+    /// Rows are always written compressed
+    void compress_successors(size_t) { }
+
+    /// Successors leave memory with their batch
+    size_t successors_bytes(size_t) const
+    {
+        return 0;
+    }
+
+    /// Returns false if a run can not be written or read back, see error()
+    bool write_to(FILE *f)
+    {
+        spill();
+        if (!error_message.empty() || (runs.size() > 1 && !merge_runs(runs.size())))
+            return false;
+
+        std::sort(initial.begin(), initial.end());
+        for (std::vector<size_t> &accepting_set : accepting)
+            std::sort(accepting_set.begin(), accepting_set.end());
+
+        // states without successors share one empty row, the last one
+        size_t empty = rows;
+        size_t row_count = rows + (std::count(row_of.begin(), row_of.end(), NONE) ? 1 : 0);
+
+        GbaWriter writer(f);
+        writer.write_header(card(), accepting.size(), 0);
+
+        writer.write_set(Successors(initial));
+        for (const std::vector<size_t> &accepting_set : accepting)
+            writer.write_set(Successors(accepting_set));
+        writer.write_row_count(row_count);
+
+        std::vector<size_t> values;
+        size_t row = 0;
+        auto flush = [&]()
+        {
+            writer.write_successors(Successors(values));
+            values.clear();
+            row++;
+        };
+
+        if (!runs.empty())
+        {
+            rewind(runs[0]);
+            Reader reader = {runs[0], {}, 0};
+            while (reader.next < reader.chunk.size() || reader.fill())
+            {
+                const Edge &edge = reader.chunk[reader.next++];
+                while (row < edge.first)
+                    flush();
+                values.push_back(edge.second);
+            }
+
+            if (ferror(runs[0]))
+                return fail("Can not read back a run");
+        }
+
+        while (row < row_count)
+            flush();
+
+        for (size_t state_row : row_of)
+            writer.write_row_of_state(state_row == NONE ? empty : state_row);
+        writer.flush();
+
+        return !ferror(f) || fail("Can not write the automaton");
+    }
+
+    const std::string &error() const
+    {
+        return error_message;
+    }
+
+private:
+    std::vector<size_t> row_of;
+    size_t rows = 0;
+    std::vector<size_t> initial;
+    std::vector<std::vector<size_t>> accepting;
+
+    std::string scratch;
+    size_t run_edges;
+    std::vector<Edge> batch;
+    std::vector<FILE*> runs;
+    std::string error_message;
+
+    bool fail(std::string message)
+    {
+        if (error_message.empty())
+            error_message = std::move(message);
+        return false;
+    }
+
+    /// A new file of the scratch directory, already unlinked
+    FILE *open_run()
+    {
+        std::string name = scratch + "/run_XXXXXX";
+        int fd = mkstemp(&name[0]);
+        if (fd < 0)
+            return nullptr;
+
+        unlink(name.c_str());
+        FILE *run = fdopen(fd, "w+b");
+        if (!run)
+            close(fd);
+        return run;
+    }
+
+    /// Sorts the batch and writes it as a run
+    void spill()
+    {
+        if (!error_message.empty())
+            batch.clear();
+        if (batch.empty())
+            return;
+
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+        FILE *run = open_run();
+        if (!run)
+        {
+            fail("Can not create a run in `" + scratch + "`");
+            return;
+        }
+
+        fwrite(batch.data(), sizeof(Edge), batch.size(), run);
+        if (ferror(run))
+        {
+            fclose(run);
+            fail("Can not write a run in `" + scratch + "`");
+            return;
+        }
+
+        batch.clear();
+        runs.push_back(run);
+        if (runs.size() >= MAX_RUNS)
+            merge_runs(MAX_RUNS);
+    }
+
+    /// Replaces the last `count` runs by one, merging them with a heap of
+    /// their smallest edges and keeping every edge once
+    bool merge_runs(size_t count)
+    {
+        if (!error_message.empty())
+            return false;
+
+        FILE *merged = open_run();
+        if (!merged)
+            return fail("Can not create a run in `" + scratch + "`");
+
+        std::vector<Reader> readers;
+        for (size_t i = runs.size() - count; i < runs.size(); i++)
+        {
+            rewind(runs[i]);
+            readers.push_back({runs[i], {}, 0});
+        }
+
+        using Head = std::pair<Edge, size_t>;       // smallest edge of a reader
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        for (size_t i = 0; i < readers.size(); i++)
+        {
+            if (readers[i].fill())
+                heads.push({readers[i].chunk[0], i});
+        }
+
+        std::vector<Edge> output;
+        Edge last(NONE, NONE);
+        while (!heads.empty())
+        {
+            Head head = heads.top();
+            heads.pop();
+
+            if (head.first != last)
+                output.push_back(head.first);
+            last = head.first;
+
+            Reader &reader = readers[head.second];
+            if (++reader.next < reader.chunk.size() || reader.fill())
+                heads.push({reader.chunk[reader.next], head.second});
+
+            if (output.size() == 4096 || heads.empty())
+            {
+                fwrite(output.data(), sizeof(Edge), output.size(), merged);
+                output.clear();
+            }
+        }
+
+        bool failed = ferror(merged);
+        for (size_t i = runs.size() - count; i < runs.size(); i++)
+        {
+            failed = failed || ferror(runs[i]);
+            fclose(runs[i]);
+        }
+        runs.resize(runs.size() - count);
+        runs.push_back(merged);
+
+        return !failed || fail("Can not merge the runs in `" + scratch + "`");
+    }
+};
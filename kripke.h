@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct KripkeError
+{
+    size_t line = 0;
+    std::string message;
+};
+
+/// Finite transition system whose states are labelled with the atoms true in
+/// them. It is read from a text file of lines
+///
+///     states N            states are numbered from 0 to N - 1
+///     init S...           initial states
+///     label S ATOM...     atoms true in S, every other atom is false in S
+///     edge S T...         transitions from S to every T
+///
+/// where empty lines and lines starting with # are skipped.
+class Kripke
+{
+public:
+    /// Returns false if the file can not be read or is malformed; the reason
+    /// is available through error() in that case.
+    bool load(const char *file_name)
+    {
+        labels.clear();
+        successors_of.clear();
+        initial_states.clear();
+        last_error = KripkeError();
+
+        FILE *f = fopen(file_name, "r");
+        if (!f)
+            return fail(0, std::string("can not open `") + file_name + "`");
+
+        char *line = nullptr;
+        size_t capacity = 0;
+        size_t line_no = 0;
+        bool ok = true;
+
+        while (ok && getline(&line, &capacity, f) >= 0)
+            ok = parse_line(line, ++line_no);
+
+        free(line);
+        fclose(f);
+
+        if (ok && labels.empty())
+            ok = fail(line_no, "no states");
+
+        if (ok && initial_states.empty())
+            ok = fail(line_no, "no initial states");
+
+        return ok;
+    }
+
+    const KripkeError &error() const
+    {
+        return last_error;
+    }
+
+    size_t size() const
+    {
+        return labels.size();
+    }
+
+    const std::vector<size_t> &initial() const
+    {
+        return initial_states;
+    }
+
+    const std::vector<std::string> &label(size_t state) const
+    {
+        return labels[state];
+    }
+
+    const std::vector<size_t> &successors(size_t state) const
+    {
+        return successors_of[state];
+    }
+
+private:
+    bool parse_line(const char *line, size_t line_no)
+    {
+        std::vector<std::string> words;
+        for (const char *c = line; *c && *c != '#';)
+        {
+            if (isspace((unsigned char) *c))
+            {
+                c++;
+                continue;
+            }
+
+            const char *begin = c;
+            while (*c && *c != '#' && !isspace((unsigned char) *c))
+                c++;
+            words.emplace_back(begin, c);
+        }
+
+        if (words.empty())
+            return true;
+
+        const std::string &keyword = words[0];
+        if (keyword == "states")
+        {
+            size_t count;
+            if (words.size() != 2 || !parse_number(words[1], count) || !count)
+                return fail(line_no, "expected `states N` with N > 0");
+            if (!labels.empty())
+                return fail(line_no, "states are declared twice");
+
+            labels.resize(count);
+            successors_of.resize(count);
+            return true;
+        }
+
+        if (labels.empty())
+            return fail(line_no, "`states N` must come first");
+
+        if (keyword == "init")
+        {
+            for (size_t i = 1; i < words.size(); i++)
+            {
+                size_t state;
+                if (!parse_state(words[i], state))
+                    return fail(line_no, "bad state `" + words[i] + "`");
+                initial_states.push_back(state);
+            }
+            return true;
+        }
+
+        size_t state;
+        if (words.size() < 2 || !parse_state(words[1], state))
+            return fail(line_no, "expected a state after `" + keyword + "`");
+
+        if (keyword == "label")
+        {
+            labels[state].insert(labels[state].end(), words.begin() + 2, words.end());
+            return true;
+        }
+
+        if (keyword == "edge")
+        {
+            for (size_t i = 2; i < words.size(); i++)
+            {
+                size_t to;
+                if (!parse_state(words[i], to))
+                    return fail(line_no, "bad state `" + words[i] + "`");
+                successors_of[state].push_back(to);
+            }
+            return true;
+        }
+
+        return fail(line_no, "unknown keyword `" + keyword + "`");
+    }
+
+    static bool parse_number(const std::string &word, size_t &number)
+    {
+        char *end;
+        number = strtoull(word.c_str(), &end, 10);
+        return !word.empty() && isdigit((unsigned char) word[0]) && !*end;
+    }
+
+    bool parse_state(const std::string &word, size_t &state) const
+    {
+        return parse_number(word, state) && state < labels.size();
+    }
+
+    bool fail(size_t line, std::string message)
+    {
+        last_error.line = line;
+        last_error.message = std::move(message);
+        return false;
+    }
+
+    std::vector<std::vector<std::string>> labels;
+    std::vector<std::vector<size_t>> successors_of;
+    std::vector<size_t> initial_states;
+    KripkeError last_error;
+};
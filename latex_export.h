@@ -1,7 +1,19 @@
+#pragma once
+
+#include "ltl.h"
+#include "rewriter.h"
+#include "split_tree.h"
+#include "translator.h"
+
 #include <cstdio>
 #include <cstdlib>
 
-void write_preamble(FILE* dst)
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+inline void write_preamble(FILE* dst)
 {
     fprintf(dst, "\\documentclass[a2paper, 9pt]{article}\n"
                  "\\usepackage[T2A]{fontenc}\n"
@@ -49,7 +61,430 @@ void write_preamble(FILE* dst)
                  "    \\end{figure}\n\n");
 }
 
-void write_ending(FILE* dst)
+inline void write_ending(FILE* dst)
 {
     fprintf(dst, "\n\\end{document}\n");
 }
+
+static const std::vector<const Ltl*> NO_DEFINITIONS;
+
+/// `closure` holds the LaTeX of every subformula of the closure
+inline void print_table_line(FILE* dst, const SplitTrees& trees, int node_idx, const std::vector<std::string>& closure, bool compact, int& states_counter, int columns_count, int column = 0, bool fill_start = false, const SplitTrees::node_type* parent = nullptr)
+{
+    const SplitTrees::node_type* node = &trees[node_idx];
+
+    if (fill_start)
+    {
+        for (int i = 0; i < column; i++)
+            fprintf(dst, "&");
+    }
+
+    std::string truth_list;
+
+    for (size_t i = 0; i < closure.size(); i++)
+    {
+        if (node->data[i] == Status::TRUE && (!compact || !parent || parent->data[i] != Status::TRUE))
+        {
+            if (not truth_list.empty())
+                truth_list.append(", ");
+
+            truth_list.append(closure[i]);
+        }
+    }
+
+    if (truth_list.empty())
+        truth_list.append("\\varnothing");
+
+    if (compact && parent)
+        truth_list = "+ " + truth_list;
+
+    if (node->first != node->NONE || node->second != node->NONE)
+        fprintf(dst, "\\multirow{%d}{*}{$%s$}", node->leafs_count(), truth_list.c_str());
+    else
+        fprintf(dst, "\\multirow{%d}{*}{$\\mathbf{s_{%d}}: %s$}", node->leafs_count(), states_counter++, truth_list.c_str());
+
+    if (node->first != node->NONE)
+    {
+        fprintf(dst, "&");
+        print_table_line(dst, trees, node->first, closure, compact, states_counter, columns_count, column+1, false, node);
+    }
+
+    else
+    {
+        for (int i = column; i < columns_count - 1; i++)
+            fprintf(dst, "&");
+        fprintf(dst, "\\\\\n");
+    }
+
+    if (node->second != node->NONE)
+        print_table_line(dst, trees, node->second, closure, compact, states_counter, columns_count, column+1, true, node);
+
+    fprintf(dst, "\\cline{%d-%d}", column + 1, columns_count);
+}
+
+/// Report policy of Translator::translate which writes the whole derivation of
+/// the automaton as a LaTeX document. Every section is written as soon as its
+/// hook is called; tables and state lists too long for a page are split.
+class LatexReport : public NoReport
+{
+public:
+    static constexpr bool enabled = true;
+    static constexpr bool split_tree = true;
+
+    static constexpr int TABLE_CHUNK_LINES = 120;   // lines of one table, each on its own page when split
+    static constexpr int LIST_CHUNK_ITEMS = 48;     // states in one line of a displayed set
+
+    explicit LatexReport(FILE *dst, bool compact = false) : dst(dst), compact(compact) { }
+
+    void on_formula(const ref_ptr<Ltl> &formula)
+    {
+        // The report shows every group of rules as a separate step; the
+        // result is the same as rewriting with all of them at once
+        static const struct
+        {
+            unsigned rules;
+            const char *comment;
+        } steps[] = {
+            {Rewriter::PUSH_X, "Заносим X внутрь операторов"},
+            {Rewriter::R_TO_U, "Выражаем R через U"},
+            {Rewriter::W_TO_U, "Выражаем W через U и G"},
+            {Rewriter::G_TO_F, "Выражаем G через F"},
+            {Rewriter::F_TO_U, "Выражаем F через U"}};
+
+        write_preamble(dst);
+
+        fprintf(dst, "\tПреобразуем исходную формулу\n");
+        fprintf(dst, "\t$$\\varphi = %s", formula->to_latex_string().c_str());
+
+        ref_ptr<Ltl> ltl = formula;
+        for (const auto &step : steps)
+        {
+            ref_ptr<Ltl> rewritten = Rewriter(factory, step.rules).rewrite(ltl);
+            if (rewritten.get() == ltl.get())
+                continue;
+
+            ltl = rewritten;
+            fprintf(dst, " = \\text{/ %s /}$$\n\t$$= %s", step.comment, ltl->to_latex_string().c_str());
+        }
+    }
+
+    void on_rewritten(const ref_ptr<Ltl> &rewritten)
+    {
+        ltl = rewritten;
+
+        while (true)
+        {
+            std::vector<const Ltl*> just_announced;
+            bool found = ltl->find_nested_untils(definitions, just_announced);
+            if (found)
+                fprintf(dst, " = $$\n\t$$= %s", ltl->to_latex_string(definitions, just_announced).c_str());
+            else
+            {
+                fprintf(dst, " = $$\n\t$$= %s", ltl->to_latex_string(definitions).c_str());
+                break;
+            }
+        }
+
+        fprintf(dst, "$$\n");
+    }
+
+    void on_closure(const std::vector<const Ltl*> &closure_atoms, const std::vector<const Ltl*> &closure)
+    {
+        atoms = &closure_atoms;
+        all = &closure;
+
+        closure_latex.clear();
+        for (auto l : closure)
+            closure_latex.push_back(l->to_latex_string(definitions, NO_DEFINITIONS, ltl.get()));
+
+        // closure index of every subformula, by structural id
+        StructuralIds ids;
+        std::unordered_map<size_t, int> index_of;
+        for (size_t i = 0; i < closure.size(); i++)
+            index_of.emplace(ids.id_of(closure[i]), (int) i);
+        auto find = [&](const Ltl *l)
+        {
+            auto it = index_of.find(ids.id_of(l));
+            return it == index_of.end() ? -1 : it->second;
+        };
+
+        atom_indices.clear();
+        for (auto atom : closure_atoms)
+            atom_indices.push_back(find(atom));
+
+        restrictions.clear();
+        for (size_t i = 0; i < closure.size(); i++)
+        {
+            const Ltl *l = closure[i];
+            if (l->kind() == Operator::X)
+                restrictions.push_back({Operator::X, (int) i, -1, -1, l->lhs()->to_latex_string(definitions, NO_DEFINITIONS, ltl.get())});
+            else if (l->kind() == Operator::U)
+                restrictions.push_back({Operator::U, (int) i, find(l->lhs()), find(l->rhs()), closure_latex[i]});
+        }
+
+        fprintf(dst, "\n\tЗапишем таблицу истинности для независимых подформул: ");
+        for (size_t i = 0; i < atoms->size(); i++)
+        {
+            fprintf(dst, "$%s$", (*atoms)[i]->to_latex_string().c_str());
+            if (i == atoms->size() - 1)
+                fprintf(dst, "\n");
+            else
+                fprintf(dst, ", ");
+        }
+    }
+
+    void on_valuation(const std::vector<bool> &atoms_mask, const SplitTrees &trees, int split_tree)
+    {
+        split_trees = &trees;
+        table_states.push_back({atoms_mask, split_tree});
+    }
+
+    void on_states(const StateTable &all_states)
+    {
+        states = &all_states;
+
+        int max_depth = 0;
+        int lines = 0;
+        for (const auto &row : table_states)
+        {
+            int depth = (*split_trees)[row.second].depth() + atoms->size();
+            if (depth > max_depth)
+                max_depth = depth;
+            lines += (*split_trees)[row.second].leafs_count();
+        }
+
+        // A row of one valuation can not be split, so a chunk may only get
+        // longer than TABLE_CHUNK_LINES when one row is
+        bool chunked = lines > TABLE_CHUNK_LINES;
+        int chunk_lines = 0;
+
+        begin_table(max_depth);
+
+        int states_counter = 1;
+        for (const auto &row : table_states)
+        {
+            int row_lines = (*split_trees)[row.second].leafs_count();
+            if (chunked && chunk_lines > 0 && chunk_lines + row_lines > TABLE_CHUNK_LINES)
+            {
+                end_table(chunked);
+                begin_table(max_depth);
+                chunk_lines = 0;
+            }
+            chunk_lines += row_lines;
+
+            for (auto atom_state : row.first)
+                fprintf(dst, "\\multirow{%d}{*}{%d} & ", row_lines, atom_state ? 1 : 0);
+
+            print_table_line(dst, *split_trees, row.second, closure_latex, compact, states_counter, max_depth, atoms->size());
+
+            fprintf(dst, "\\hline\n");
+        }
+
+        end_table(chunked);
+    }
+
+    void on_initial_begin()
+    {
+        fprintf(dst, "\n\tНачальные состояния:\n\n\t$$\n\t\tI = \\{s: \\varphi \\in s\\} = \\{");
+        first_item = true;
+    }
+
+    void on_initial(size_t state)
+    {
+        list_item(state);
+    }
+
+    void on_initial_end()
+    {
+        fprintf(dst, "\\}\n\t$$\n");
+    }
+
+    void on_accepting_begin()
+    {
+        int U_count = 0;
+        for (auto l : *all)
+        {
+            if (l->kind() == Operator::U)
+                U_count++;
+        }
+
+        fprintf(dst, "\n\tВ формуле имеется %d операций $\\UNTIL$, таким образом"
+                " будет %d множеств допускающих состояний: \n", 
+                U_count, U_count);
+    }
+
+    void on_accepting_set(const Ltl *l, const Ltl *right)
+    {
+        fprintf(dst, "\n\t$$\n\t\tF_{%s} = \\{s: %s \\in s \\OR %s \\notin s \\} = \\{", 
+                l->to_latex_string(definitions, NO_DEFINITIONS, ltl.get()).c_str(), 
+                right->to_latex_string(definitions, NO_DEFINITIONS, ltl.get()).c_str(), 
+                l->to_latex_string(definitions, NO_DEFINITIONS, ltl.get()).c_str());
+        first_item = true;
+    }
+
+    void on_accepting(size_t state)
+    {
+        list_item(state);
+    }
+
+    void on_accepting_set_end()
+    {
+        fprintf(dst, "\\}\n\t$$\n");
+    }
+
+    void on_transitions_begin()
+    {
+        fprintf(dst, "\n\tВычислим переходы между узлами:\n\n");
+    }
+
+    void on_successors_begin(size_t from)
+    {
+        const Status *state = (*states)[from];
+
+        std::string atoms_truth;
+        for (size_t i = 0; i < atoms->size(); i++)
+        {
+            if (atom_indices[i] >= 0 and state[atom_indices[i]] == Status::TRUE)
+            {
+                if (not atoms_truth.empty())
+                    atoms_truth.append(", ");
+                atoms_truth.append((*atoms)[i]->to_latex_string());
+            }
+        }
+
+        if (atoms_truth.empty())
+            atoms_truth.append("\\varnothing");
+        else
+            atoms_truth = "\\{" + atoms_truth + "\\}";
+
+        fprintf(dst, "\t$$\n\t\t\\delta(s_{%zu}, %s) = ", from+1, atoms_truth.c_str());
+
+        // The first state with a set of rules defines it, the later ones
+        // refer to its transition function
+        auto inserted = rule_definitions.emplace(edge_restrictions(state), std::string());
+        if (inserted.second)
+        {
+            inserted.first->second = "\\delta(s_{" + std::to_string(from + 1) + "}, " + atoms_truth + ")";
+            fprintf(dst, "\\{s': %s\\} = \\{", inserted.first->first.c_str());
+        }
+        else
+            fprintf(dst, "%s = \\{", inserted.first->second.c_str());
+
+        first_item = true;
+    }
+
+    void on_successor(size_t to)
+    {
+        list_item(to);
+    }
+
+    void on_successors_end()
+    {
+        fprintf(dst, "\\}\n\t$$\n");
+    }
+
+    void on_end()
+    {
+        write_ending(dst);
+    }
+
+    void on_exceeded(const BudgetStatus &status)
+    {
+        fprintf(dst, "\n\tПостроение прервано: превышен предел \\texttt{%s}, найдено %zu состояний и %zu переходов\n",
+                RESOURCE_NAMES[(int) status.exceeded], status.states, status.edges);
+        write_ending(dst);
+    }
+
+private:
+    /// Closure indices and LaTeX of one U or X rule on the successors
+    struct Restriction
+    {
+        Operator kind;
+        int idx;
+        int lhs_idx;
+        int rhs_idx;
+        std::string text;
+    };
+
+    std::string edge_restrictions(const Status *state) const
+    {
+        std::string result;
+
+        for (const Restriction &rule : restrictions)
+        {
+            if (rule.kind == Operator::U && !(state[rule.lhs_idx] == Status::TRUE && state[rule.rhs_idx] == Status::FALSE))
+                continue;
+
+            if (not result.empty())
+                result.append(" \\AND ");
+            result.append(rule.text);
+            result.append(state[rule.idx] == Status::TRUE ? " \\in " : " \\notin ");
+            result.append("s'");
+        }
+
+        return result;
+    }
+
+    void begin_table(int columns_count)
+    {
+        fprintf(dst, "\t\\begin{table}[h!]\n\t\t\\begin{tabular}{|");
+        for (size_t i = 0; i < atoms->size(); i++)
+            fprintf(dst, "c|");
+        for (int i = atoms->size(); i < columns_count; i++)
+            fprintf(dst, "l|");
+
+        fprintf(dst, "}\n\t\t\t\\hline\n\t\t\t");
+        for (int i = 0; i < columns_count; i++)
+        {
+            if (i < (int) atoms->size())
+                fprintf(dst, "$%s$", (*atoms)[i]->to_latex_string().c_str());
+            else
+                fprintf(dst, " ");
+            if (i != columns_count - 1)
+                fprintf(dst, "&");
+        }
+        fprintf(dst, "\\\\\n\t\t\t\\hline\n");
+    }
+
+    /// Chunks of a split table are flushed one per page, so that the
+    /// floats do not pile up
+    void end_table(bool chunked)
+    {
+        fprintf(dst, "\t\t\\end{tabular}\n\t\\end{table}\n");
+        if (chunked)
+            fprintf(dst, "\t\\clearpage\n");
+    }
+
+    void list_item(size_t state)
+    {
+        if (not first_item)
+        {
+            fprintf(dst, ", ");
+            if (list_items % LIST_CHUNK_ITEMS == 0)
+                fprintf(dst, "$$\n\t$$\n\t\t\\qquad ");
+        }
+        else
+            list_items = 0;
+
+        first_item = false;
+        list_items++;
+        fprintf(dst, "s_{%zu}", state + 1);
+    }
+
+    FILE *dst;
+    bool compact;
+    LtlFactory factory;
+    ref_ptr<Ltl> ltl;
+    std::vector<const Ltl*> definitions;
+    const std::vector<const Ltl*> *atoms = nullptr;
+    const std::vector<const Ltl*> *all = nullptr;
+    const StateTable *states = nullptr;
+    const SplitTrees *split_trees = nullptr;
+    std::vector<std::pair<std::vector<bool>, int>> table_states;
+    std::vector<std::string> closure_latex;
+    std::vector<int> atom_indices;
+    std::vector<Restriction> restrictions;
+    std::unordered_map<std::string, std::string> rule_definitions;     // restrictions -> the transition function defined by them
+    bool first_item = true;
+    size_t list_items = 0;
+};
@@ -0,0 +1,883 @@
+#pragma once
+
+#include "ref_ptr.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+enum class Operator : uint8_t
+{
+    TRUE,
+    FALSE,
+    ATOM,
+    UNARY_FIRST,
+    NOT = UNARY_FIRST,
+    X,
+    F,
+    G,
+    BINARY_FIRST,
+    AND = BINARY_FIRST,
+    OR,
+    IMPL,
+    U,
+    W,
+    R
+};
+
+enum class Status : uint8_t
+{
+    UNKNOWN, TRUE, FALSE
+};
+
+/// Statuses of one subformula under 64 valuations at once, bit `i` of the
+/// words for valuation `i`: UNKNOWN where `known` is clear, otherwise TRUE or
+/// FALSE by `value`, which is clear wherever `known` is
+struct StatusSlice
+{
+    uint64_t known;
+    uint64_t value;
+};
+
+static const struct
+{
+    char sym;
+    Operator opc;
+} opcodes[] = {
+    {'!', Operator::NOT},
+    {'&', Operator::AND},
+    {'|', Operator::OR},
+    {'U', Operator::U},
+    {'F', Operator::F},
+    {'G', Operator::G},
+    {'R', Operator::R},
+    {'W', Operator::W},
+    {'X', Operator::X}};
+
+static const std::string DEFINITION_NAMES[] = {
+    "\\alpha",
+    "\\beta",
+    "\\gamma",
+    "\\delta",
+    "\\varepsilon",
+    "\\zeta",
+    "\\eta",
+    "\\vartheta",
+    "\\mu",
+    "\\nu",
+    "\\xi",
+    "\\rho",
+    "\\sigma",
+    "\\chi",
+    "\\psi",
+    "\\omega"
+};
+
+static char symbol_of(Operator opc)
+{
+    for (const auto &item : opcodes)
+    {
+        if (item.opc == opc)
+        {
+            return item.sym;
+        }
+    }
+    return '\0';
+}
+
+class Ltl;
+
+/// Numbers formulas by structure: two formulas get the same id exactly when
+/// they are equal, whether their nodes are shared or not. Every node is
+/// numbered once, from the ids of its operands.
+class StructuralIds
+{
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    /// Numbers `ltl` and the nodes below it which are not numbered yet
+    size_t id_of(const Ltl *ltl);
+
+    /// Number of different formulas numbered so far
+    size_t size() const
+    {
+        return keys.size();
+    }
+
+    void clear()
+    {
+        ids.clear();
+        keys.clear();
+    }
+
+private:
+    using Key = std::tuple<Operator, std::string, size_t, size_t>;
+
+    std::unordered_map<const Ltl*, size_t> ids;
+    std::map<Key, size_t> keys;
+};
+
+#ifdef BUCHI_ATOMIC_REFCOUNT
+using ltl_refcount = atomic_refcount;
+#else
+using ltl_refcount = plain_refcount;
+#endif
+
+class Ltl
+{
+    friend void ref_ptr_inc_ref(Ltl &);
+    friend void ref_ptr_release(Ltl &);
+    friend class Rewriter;
+    friend class LtlFactory;
+
+public:
+    using ref_type = ref_ptr<Ltl>;
+
+    /// The constants are immortal and shared by every thread
+    static ref_type True()
+    {
+        static Ltl ltl_true(Operator::TRUE, true);
+        return &ltl_true;
+    }
+
+    static ref_type False()
+    {
+        static Ltl ltl_false(Operator::FALSE, true);
+        return &ltl_false;
+    }
+
+    static ref_type atom(std::string name)
+    {
+        return new Ltl(std::move(name));
+    }
+
+    static ref_type unary(Operator opc, const ref_type &opnd)
+    {
+        ref_type ltl = new Ltl(opc);
+        ltl->lop = opnd;
+
+        return ltl;
+    }
+
+    static ref_type binary(Operator opc, const ref_type &lop, const ref_type &rop)
+    {
+        ref_type ltl = new Ltl(opc);
+        ltl->lop = lop;
+        ltl->rop = rop;
+
+        return ltl;
+    }
+
+    Operator kind() const
+    {
+        return opc;
+    }
+
+    const Ltl *lhs() const
+    {
+        return lop.get();
+    }
+
+    const Ltl *rhs() const
+    {
+        return rop.get();
+    }
+
+    /// Calls `visit` once for every distinct node of the formula rooted at
+    /// `root`, children before their parent and left before right, using an
+    /// explicit stack. A shared subformula is visited where it first occurs.
+    template<class F>
+    static void for_each_postorder(const Ltl *root, F &&visit)
+    {
+        struct Frame
+        {
+            const Ltl *ltl;
+            bool expanded;
+        };
+
+        std::unordered_set<const Ltl*> visited;
+        std::vector<Frame> stack = {{root, false}};
+
+        while (!stack.empty())
+        {
+            const Ltl *ltl = stack.back().ltl;
+
+            if (stack.back().expanded)
+            {
+                stack.pop_back();
+                visited.insert(ltl);
+                visit(ltl);
+                continue;
+            }
+
+            // a node can be pushed again before its first copy is visited
+            if (visited.count(ltl))
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            stack.back().expanded = true;
+            if (ltl->rhs() && !visited.count(ltl->rhs()))
+                stack.push_back({ltl->rhs(), false});
+            if (ltl->lhs() && !visited.count(ltl->lhs()))
+                stack.push_back({ltl->lhs(), false});
+        }
+    }
+
+    /// A shared subformula is printed once, its other occurrences copy the
+    /// text
+    void to_string(std::string &s) const
+    {
+        PrintedText printed;
+        std::vector<PrintItem> stack = {{this, nullptr}};
+
+        while (!stack.empty())
+        {
+            PrintItem item = stack.back();
+            stack.pop_back();
+
+            if (printed.handled(item, s, stack))
+                continue;
+
+            const Ltl *ltl = item.ltl;
+            switch (ltl->opc)
+            {
+                case Operator::TRUE:
+                    s.append("true");
+                    break;
+                case Operator::FALSE:
+                    s.append("false");
+                    break;
+                case Operator::ATOM:
+                    s.append(ltl->name);
+                    break;
+
+                case Operator::NOT:
+                case Operator::G:
+                case Operator::F:
+                case Operator::X:
+                    s.push_back(symbol_of(ltl->opc));
+                    stack.push_back({ltl->lhs(), nullptr});
+                    break;
+
+                case Operator::AND:
+                case Operator::OR:
+                case Operator::IMPL:
+                case Operator::U:
+                case Operator::R:
+                case Operator::W:
+                    s.push_back('(');
+                    stack.push_back({nullptr, ")"});
+                    stack.push_back({ltl->rhs(), nullptr});
+                    stack.push_back({nullptr, infix_of(ltl->opc)});
+                    stack.push_back({ltl->lhs(), nullptr});
+                    break;
+            }
+        }
+    }
+
+    // returns true if not presented "until" found in current subtree, false if not found 
+    bool find_nested_untils(std::vector<const Ltl*>& untils, std::vector<const Ltl*>& currently_found) const
+    {
+        // result of every subformula already visited
+        std::unordered_map<const Ltl*, bool> found;
+        StructuralIds ids;
+        std::unordered_set<size_t> known;       // ids of `untils`
+        for (const Ltl *until : untils)
+            known.insert(ids.id_of(until));
+
+        for_each_postorder(this, [&](const Ltl *ltl)
+        {
+            bool already_found = false;
+
+            if (ltl->rhs())
+                already_found |= found[ltl->rhs()];
+            if (ltl->lhs())
+                already_found |= found[ltl->lhs()];
+
+            if (ltl != this and ltl->kind() == Operator::U and not already_found and known.insert(ids.id_of(ltl)).second)
+            {
+                untils.push_back(ltl);
+                currently_found.push_back(ltl);
+                already_found = true;
+            }
+
+            found[ltl] = already_found;
+        });
+
+        return found[this];
+    }
+
+    std::string to_latex_string(const std::vector<const Ltl*> &definitions = {}, const std::vector<const Ltl*> &just_announced = {}, const Ltl* initial_ltl = nullptr) const
+    {
+        StructuralIds ids;
+        if (initial_ltl and ids.id_of(this) == ids.id_of(initial_ltl))
+            return "\\varphi";
+
+        // index of the first equal definition and whether it is announced, by id
+        std::unordered_map<size_t, size_t> definition_of;
+        std::unordered_set<size_t> announced_ids;
+        for (size_t i = 0; i < definitions.size(); i++)
+            definition_of.emplace(ids.id_of(definitions[i]), i);
+        for (const Ltl *announced : just_announced)
+            announced_ids.insert(ids.id_of(announced));
+
+        std::string s;
+        PrintedText printed;
+        std::vector<PrintItem> stack = {{this, nullptr}};
+
+        while (!stack.empty())
+        {
+            PrintItem item = stack.back();
+            stack.pop_back();
+
+            if (printed.handled(item, s, stack))
+                continue;
+
+            const Ltl *ltl = item.ltl;
+            switch (ltl->opc)
+            {
+                case Operator::TRUE:
+                    s.append("\\TRUE");
+                    break;
+                case Operator::FALSE:
+                    s.append("\\FALSE");
+                    break;
+                case Operator::ATOM:
+                    s.append(ltl->name);
+                    break;
+
+                case Operator::NOT:
+                case Operator::G:
+                case Operator::F:
+                case Operator::X:
+                    s.append(latex_of(ltl->opc));
+                    stack.push_back({ltl->lhs(), nullptr});
+                    break;
+
+                case Operator::U:
+                {
+                    size_t id = ids.id_of(ltl);
+                    auto definition = definition_of.find(id);
+                    int definition_idx = definition == definition_of.end() ? -1 : (int) definition->second;
+                    bool announced = announced_ids.count(id) > 0;
+                    if (definition_idx >= 0 and not announced)
+                    {
+                        s.append(DEFINITION_NAMES[definition_idx]);
+                        break;
+                    }
+
+                    if (definition_idx >= 0 and announced)
+                    {
+                        s.append("\\overbrace{");
+                        stack.push_back({nullptr, "}"});
+                        stack.push_back({nullptr, DEFINITION_NAMES[definition_idx].c_str()});
+                        stack.push_back({nullptr, "}^{"});
+                    }
+                }
+                // fallthrough
+
+                case Operator::AND:
+                case Operator::OR:
+                case Operator::IMPL:
+                case Operator::R:
+                case Operator::W:
+                    s.push_back('(');
+                    stack.push_back({nullptr, ")"});
+                    stack.push_back({ltl->rhs(), nullptr});
+                    stack.push_back({nullptr, latex_of(ltl->opc)});
+                    stack.push_back({ltl->lhs(), nullptr});
+                    break;
+            }
+        }
+
+        return s;
+    }
+
+    std::string node_to_string() const
+    {
+        switch (opc)
+        {
+            case Operator::TRUE: return "true";
+            case Operator::FALSE: return "false";
+            case Operator::ATOM: return name;
+            case Operator::IMPL: return "{→|implication}";
+            case Operator::NOT: return "{!|not}";
+            case Operator::G: return "{G|globally}";
+            case Operator::F: return "{F|future}";
+            case Operator::X: return "{X|next}";
+            case Operator::AND: return "{&|and}";
+            case Operator::OR: return "{\\||or}";
+            case Operator::U: return "{U|until}";
+            case Operator::R: return "{R|release}";
+            case Operator::W: return "{W|weak until}";
+            default: return "{|UNKNOWN|}";
+        }
+    }
+
+    void dump_to(FILE *f) const
+    {
+        // either a node to dump or an edge from `parent` to an already dumped child
+        struct Item
+        {
+            const Ltl *ltl;
+            const Ltl *parent;
+            const char *label;
+        };
+
+        fprintf(f, "digraph G {\trankdir=LR;\n");
+
+        // a shared subformula is dumped once and gets an edge from every parent
+        std::unordered_set<const Ltl*> dumped;
+        std::vector<Item> stack = {{this, nullptr, nullptr}};
+
+        while (!stack.empty())
+        {
+            Item item = stack.back();
+            stack.pop_back();
+
+            if (item.parent)
+            {
+                fprintf(f, "\taddr%p -> addr%p[label=\"%s\"]\n", item.parent, item.ltl, item.label);
+                continue;
+            }
+
+            const Ltl *ltl = item.ltl;
+            if (!dumped.insert(ltl).second)
+                continue;
+
+            fprintf(f, "\taddr%p[label=", ltl);
+            fprintf(f, "\"{%s|{kind = %d}}\"", ltl->node_to_string().c_str(), ltl->kind());
+            fprintf(f, ", shape=\"record\"]\n");
+
+            if (ltl->rhs())
+            {
+                stack.push_back({ltl->rhs(), ltl, ".rhs"});
+                stack.push_back({ltl->rhs(), nullptr, nullptr});
+            }
+            if (ltl->lhs())
+            {
+                stack.push_back({ltl->lhs(), ltl, ".lhs"});
+                stack.push_back({ltl->lhs(), nullptr, nullptr});
+            }
+        }
+
+        fprintf(f, "}");
+    }
+
+    /// Structural equality, through the structural ids of both formulas
+    bool operator==(const Ltl& other) const;
+
+    /// Status of an `opc` node from the statuses of its operands
+    static Status evaluate(Operator opc, Status l_status, Status r_status)
+    {
+        switch (opc)
+        {
+            case Operator::TRUE:
+                return Status::TRUE;
+
+            case Operator::FALSE:
+                return Status::FALSE;
+
+            case Operator::NOT:
+                switch (l_status)
+                {
+                    case Status::TRUE: return Status::FALSE;
+                    case Status::FALSE: return Status::TRUE;
+                    default: return Status::UNKNOWN;
+                }
+
+            case Operator::AND:
+                if (l_status == Status::TRUE && r_status == Status::TRUE)
+                    return Status::TRUE;
+                else if (l_status == Status::FALSE || r_status == Status::FALSE)
+                    return Status::FALSE;
+                else
+                    return Status::UNKNOWN;
+
+            case Operator::OR:
+                if (l_status == Status::TRUE || r_status == Status::TRUE)
+                    return Status::TRUE;
+                else if (l_status == Status::FALSE && r_status == Status::FALSE)
+                    return Status::FALSE;
+                else
+                    return Status::UNKNOWN;
+
+            case Operator::IMPL:
+                if (l_status == Status::FALSE || r_status == Status::TRUE)
+                    return Status::TRUE;
+                else if (l_status == Status::TRUE && r_status == Status::FALSE)
+                    return Status::FALSE;
+                else
+                    return Status::UNKNOWN;
+
+            case Operator::U:
+                if (r_status == Status::TRUE)
+                    return Status::TRUE;
+                else if (l_status == Status::FALSE && r_status == Status::FALSE)
+                    return Status::FALSE;
+                else
+                    return Status::UNKNOWN;
+
+            case Operator::F:
+                if (l_status == Status::TRUE)
+                    return Status::TRUE;
+                else
+                    return Status::UNKNOWN;
+
+            case Operator::G:
+                if (l_status == Status::FALSE)
+                    return Status::FALSE;
+                else
+                    return Status::UNKNOWN;
+
+            // [TODO] INCORRECT
+            case Operator::W:
+                printf("Can not calc W\n");
+                return Status::UNKNOWN;
+
+            // [TODO] INCORRECT
+            case Operator::R:
+                printf("Can not calc R\n");
+                return Status::UNKNOWN;
+
+            case Operator::ATOM:
+            case Operator::X:
+            default:
+                printf("UNREACHABLE CODE!\n");
+                return Status::UNKNOWN;
+        }
+    }
+
+    /// The same rules as above for 64 valuations, bit-sliced
+    static StatusSlice evaluate(Operator opc, StatusSlice l, StatusSlice r)
+    {
+        uint64_t l_true = l.known & l.value, l_false = l.known & ~l.value;
+        uint64_t r_true = r.known & r.value, r_false = r.known & ~r.value;
+        uint64_t is_true, is_false;
+
+        switch (opc)
+        {
+            case Operator::TRUE: is_true = ~uint64_t(0); is_false = 0; break;
+            case Operator::FALSE: is_true = 0; is_false = ~uint64_t(0); break;
+            case Operator::NOT: is_true = l_false; is_false = l_true; break;
+            case Operator::AND: is_true = l_true & r_true; is_false = l_false | r_false; break;
+            case Operator::OR: is_true = l_true | r_true; is_false = l_false & r_false; break;
+            case Operator::IMPL: is_true = l_false | r_true; is_false = l_true & r_false; break;
+            case Operator::U: is_true = r_true; is_false = l_false & r_false; break;
+            case Operator::F: is_true = l_true; is_false = 0; break;
+            case Operator::G: is_true = 0; is_false = l_false; break;
+
+            default:
+                // the atoms and X are never evaluated, W and R are rewritten away
+                assert(opc != Operator::W && opc != Operator::R && "W or R left by the rewriter");
+                return {0, 0};
+        }
+
+        return {is_true | is_false, is_true};
+    }
+
+private:
+    /// A subformula still to be printed, a literal piece of text or, with
+    /// `start` set, the end of the text of `ltl`, which began at `start`
+    struct PrintItem
+    {
+        const Ltl *ltl;
+        const char *text;
+        size_t start = SIZE_MAX;
+    };
+
+    /// Start and length of the text of every subformula printed so far
+    struct PrintedText
+    {
+        std::unordered_map<const Ltl*, std::pair<size_t, size_t>> spans;
+
+        /// Appends the text of `item` if it is known, otherwise `item` is a
+        /// subformula to print and the end of its text is pushed
+        bool handled(const PrintItem &item, std::string &s, std::vector<PrintItem> &stack)
+        {
+            if (!item.ltl)
+            {
+                s.append(item.text);
+                return true;
+            }
+
+            if (item.start != SIZE_MAX)
+            {
+                spans.emplace(item.ltl, std::make_pair(item.start, s.size() - item.start));
+                return true;
+            }
+
+            auto it = spans.find(item.ltl);
+            if (it != spans.end())
+            {
+                s.append(s, it->second.first, it->second.second);
+                return true;
+            }
+
+            if (item.ltl->lhs())
+                stack.push_back({item.ltl, nullptr, s.size()});
+            return false;
+        }
+    };
+
+    static const char *infix_of(Operator opc)
+    {
+        switch (opc)
+        {
+            case Operator::AND: return " & ";
+            case Operator::OR: return " | ";
+            case Operator::IMPL: return " -> ";
+            case Operator::U: return " U ";
+            case Operator::R: return " R ";
+            case Operator::W: return " W ";
+            default: return " ? ";
+        }
+    }
+
+    static const char *latex_of(Operator opc)
+    {
+        switch (opc)
+        {
+            case Operator::NOT: return "\\NOT ";
+            case Operator::X: return "\\NEXT ";
+            case Operator::F: return "\\FUTURE ";
+            case Operator::G: return "\\GLOBALLY ";
+            case Operator::AND: return " \\AND ";
+            case Operator::OR: return " \\OR ";
+            case Operator::IMPL: return " \\IMPL ";
+            case Operator::U: return " \\UNTIL ";
+            case Operator::R: return " \\RELEASE ";
+            case Operator::W: return " \\WEAK ";
+            default: return " ? ";
+        }
+    }
+
+    Ltl(std::string _name)
+    {
+        opc = Operator::ATOM;
+        name = std::move(_name);
+        lop = nullptr;
+        rop = nullptr;
+    }
+
+    Ltl(Operator _opc, bool immortal = false) : nref(immortal)
+    {
+        opc = _opc;
+        lop = nullptr;
+        rop = nullptr;
+    }
+
+    Ltl(const Ltl &) = delete;
+    void operator=(const Ltl &) = delete;
+
+    ref_count<ltl_refcount> nref;
+    Operator opc;
+    std::string name;
+    ref_type lop, rop;
+};
+
+inline void ref_ptr_inc_ref(Ltl &x)
+{
+    x.nref.increment();
+}
+
+inline void ref_ptr_release(Ltl &x)
+{
+    if (!x.nref.decrement())
+        return;
+
+    // Children are detached before deletion and freed from a worklist, so
+    // dropping a deep formula does not recurse through ~Ltl
+    std::vector<Ltl*> garbage = {&x};
+    while (!garbage.empty())
+    {
+        Ltl *ltl = garbage.back();
+        garbage.pop_back();
+
+        for (Ltl *child : {ltl->lop.release(), ltl->rop.release()})
+        {
+            if (child && child->nref.decrement())
+                garbage.push_back(child);
+        }
+
+        delete ltl;
+    }
+}
+
+/// Creates formulas for one owner. The atoms it hands out are shared through
+/// its own table and the constants are the immortal ones of Ltl, so formulas
+/// built by different factories can be used from different threads.
+class LtlFactory
+{
+public:
+    using ref_type = Ltl::ref_type;
+
+    LtlFactory() : ltl_true(Ltl::True()), ltl_false(Ltl::False()) { }
+
+    LtlFactory(const LtlFactory &) = delete;
+    LtlFactory &operator=(const LtlFactory &) = delete;
+
+    const ref_type &True() const
+    {
+        return ltl_true;
+    }
+
+    const ref_type &False() const
+    {
+        return ltl_false;
+    }
+
+    ref_type atom(const std::string &name)
+    {
+        auto it = atoms.find(name);
+        if (it == atoms.end())
+            it = atoms.emplace(name, Ltl::atom(name)).first;
+
+        return it->second;
+    }
+
+    ref_type unary(Operator opc, const ref_type &opnd) const
+    {
+        return Ltl::unary(opc, opnd);
+    }
+
+    ref_type binary(Operator opc, const ref_type &lop, const ref_type &rop) const
+    {
+        return Ltl::binary(opc, lop, rop);
+    }
+
+    /// A formula equal to `ltl` made of nodes of this factory. `ltl` is only
+    /// read, so it can come from the factory of another thread as long as
+    /// it outlives the copy.
+    ref_type copy(const Ltl *ltl)
+    {
+        std::unordered_map<const Ltl*, ref_type> copies;
+
+        Ltl::for_each_postorder(ltl, [&](const Ltl *node)
+        {
+            ref_type copied;
+            switch (node->kind())
+            {
+                case Operator::TRUE: copied = ltl_true; break;
+                case Operator::FALSE: copied = ltl_false; break;
+                case Operator::ATOM: copied = atom(node->name); break;
+                default:
+                    if (node->rhs())
+                        copied = binary(node->kind(), copies[node->lhs()], copies[node->rhs()]);
+                    else
+                        copied = unary(node->kind(), copies[node->lhs()]);
+                    break;
+            }
+            copies.emplace(node, std::move(copied));
+        });
+
+        return copies[ltl];
+    }
+
+private:
+    ref_type ltl_true;
+    ref_type ltl_false;
+    std::unordered_map<std::string, ref_type> atoms;
+};
+
+inline size_t StructuralIds::id_of(const Ltl *ltl)
+{
+    auto it = ids.find(ltl);
+    if (it != ids.end())
+        return it->second;
+
+    std::vector<const Ltl*> stack = {ltl};
+    while (!stack.empty())
+    {
+        const Ltl *top = stack.back();
+        if (ids.count(top))
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        bool ready = true;
+        for (const Ltl *operand : {top->rhs(), top->lhs()})
+        {
+            if (operand && !ids.count(operand))
+            {
+                stack.push_back(operand);
+                ready = false;
+            }
+        }
+        if (!ready)
+            continue;
+
+        stack.pop_back();
+        Key key(top->kind(), top->kind() == Operator::ATOM ? top->node_to_string() : std::string(),
+                top->lhs() ? ids[top->lhs()] : NONE, top->rhs() ? ids[top->rhs()] : NONE);
+        ids.emplace(top, keys.emplace(key, keys.size()).first->second);
+    }
+
+    return ids[ltl];
+}
+
+inline bool Ltl::operator==(const Ltl& other) const
+{
+    if (this == &other)
+        return true;
+    if (kind() != other.kind() || name != other.name || !lhs() != !other.lhs() || !rhs() != !other.rhs())
+        return false;
+    if (!lhs())
+        return true;
+
+    StructuralIds ids;
+    return ids.id_of(this) == ids.id_of(&other);
+}
+
+/// Appends the subformulas of `ltl` which `keep` accepts and which are not
+/// equal to one already in `distinct`, in post-order
+template<class F>
+void add_distinct(const Ltl *ltl, std::vector<const Ltl*> &distinct, F &&keep)
+{
+    StructuralIds ids;
+    std::vector<bool> present;
+    auto add = [&](const Ltl *subltl)
+    {
+        size_t id = ids.id_of(subltl);
+        if (id >= present.size())
+            present.resize(id + 1);
+        if (present[id])
+            return false;
+        present[id] = true;
+        return true;
+    };
+
+    for (const Ltl *subltl : distinct)
+        add(subltl);
+
+    Ltl::for_each_postorder(ltl, [&](const Ltl *subltl)
+    {
+        if (keep(subltl) && add(subltl))
+            distinct.push_back(subltl);
+    });
+}
+
+inline void get_atoms(const Ltl* ltl, std::vector<const Ltl*>& atoms)
+{
+    add_distinct(ltl, atoms, [](const Ltl *subltl)
+    {
+        return subltl->kind() == Operator::X || subltl->kind() == Operator::ATOM;
+    });
+}
+
+inline void get_all(const Ltl* ltl, std::vector<const Ltl*>& all)
+{
+    add_distinct(ltl, all, [](const Ltl *) { return true; });
+}
@@ -0,0 +1,376 @@
+#pragma once
+
+#include "kripke.h"
+#include "translator.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Outcome of checking a Kripke structure against a formula
+struct CheckResult
+{
+    bool holds = true;
+    std::vector<size_t> prefix;     // Kripke states of a violating path: the prefix,
+    std::vector<size_t> cycle;      // then the cycle repeated forever
+    size_t product_states = 0;      // states of the product the search has reached
+};
+
+/// Checks that every infinite path of a Kripke structure satisfies a formula.
+/// The product with the tableau of the negated formula is explored on the
+/// fly: the tableau states of a valuation are built the first time a Kripke
+/// state with that valuation is reached, the successors are found by the
+/// edge rules of the translator, and the product is searched for an
+/// accepting cycle by the emptiness check of Couvreur for generalized Büchi
+/// automata. Finite paths which end in a state without successors are not
+/// checked.
+class ModelChecker
+{
+public:
+    ModelChecker(Translator &translator, const Kripke &kripke) : translator(translator), kripke(kripke) { }
+
+    /// Returns false if the budget of the translator is exceeded while the
+    /// tableau states are built
+    bool check(const ref_ptr<Ltl> &formula, CheckResult &result)
+    {
+        result = CheckResult();
+        clear();
+
+        if (!translator.build_tableau(translator.factory().unary(Operator::NOT, formula)))
+            return false;
+
+        sets_count = translator.acceptance_sets_count();
+        words = (sets_count + 63) / 64;
+        build_values();
+
+        std::vector<size_t> initial;
+        for (size_t k : kripke.initial())
+        {
+            translator.for_each_state_with(values[k], [&](size_t q)
+            {
+                if (translator.is_initial(q))
+                    initial.push_back(state_of(k, q));
+            });
+        }
+
+        for (size_t s : initial)
+        {
+            if (out_of_budget())
+                return false;
+            if (number[s])
+                continue;
+
+            if (search(s, result))
+                break;
+        }
+
+        if (out_of_budget())
+            return false;
+
+        result.product_states = visited;
+        return true;
+    }
+
+private:
+    struct Root
+    {
+        size_t number;
+        std::vector<uint64_t> acc;
+    };
+
+    struct Todo
+    {
+        size_t state;
+        std::vector<size_t> successors;
+        size_t next;
+    };
+
+    void clear()
+    {
+        ids.clear();
+        kripke_of.clear();
+        tableau_of.clear();
+        number.clear();
+        dead.clear();
+        roots.clear();
+        live.clear();
+        todo.clear();
+        visited = 0;
+    }
+
+    /// Values of the tableau atoms in every Kripke state, X atoms are false
+    void build_values()
+    {
+        const std::vector<const Ltl*> &atoms = translator.tableau_atoms();
+
+        values.assign(kripke.size(), std::vector<bool>(atoms.size(), false));
+        for (size_t k = 0; k < kripke.size(); k++)
+        {
+            for (size_t i = 0; i < atoms.size(); i++)
+            {
+                if (atoms[i]->kind() != Operator::ATOM)
+                    continue;
+
+                for (const std::string &name : kripke.label(k))
+                {
+                    if (name == atoms[i]->node_to_string())
+                        values[k][i] = true;
+                }
+            }
+        }
+    }
+
+    bool out_of_budget() const
+    {
+        return translator.budget_status().exceeded != Resource::NONE;
+    }
+
+    /// Product state of Kripke state `k` and tableau state `q`, numbered the
+    /// first time it is seen; the tableau grows during the search, so the
+    /// key is made from the number of Kripke states
+    size_t state_of(size_t k, size_t q)
+    {
+        uint64_t key = uint64_t(q) * kripke.size() + k;
+        auto it = ids.find(key);
+        if (it != ids.end())
+            return it->second;
+
+        size_t id = kripke_of.size();
+        ids.emplace(key, id);
+        kripke_of.push_back(k);
+        tableau_of.push_back(q);
+        number.push_back(0);
+        dead.push_back(false);
+        return id;
+    }
+
+    std::vector<size_t> successors(size_t s)
+    {
+        std::vector<size_t> result;
+        size_t q = tableau_of[s];
+
+        for (size_t k : kripke.successors(kripke_of[s]))
+        {
+            translator.for_each_state_with(values[k], [&](size_t to)
+            {
+                if (translator.has_transition(q, to))
+                    result.push_back(state_of(k, to));
+            });
+        }
+
+        return result;
+    }
+
+    std::vector<uint64_t> acceptance_of(size_t s) const
+    {
+        std::vector<uint64_t> acc(words, 0);
+        for (size_t set = 0; set < sets_count; set++)
+        {
+            if (translator.is_accepting(set, tableau_of[s]))
+                acc[set / 64] |= uint64_t(1) << (set % 64);
+        }
+        return acc;
+    }
+
+    bool all_sets(const std::vector<uint64_t> &acc) const
+    {
+        for (size_t set = 0; set < sets_count; set++)
+        {
+            if (!(acc[set / 64] >> (set % 64) & 1))
+                return false;
+        }
+        return true;
+    }
+
+    void push(size_t s)
+    {
+        number[s] = ++visited;
+        roots.push_back({visited, acceptance_of(s)});
+        live.push_back(s);
+        todo.push_back({s, successors(s), 0});
+    }
+
+    /// Depth-first search from `initial`, returns true and fills `result`
+    /// when an accepting cycle is found
+    bool search(size_t initial, CheckResult &result)
+    {
+        push(initial);
+        if (out_of_budget())
+            return false;
+
+        while (!todo.empty())
+        {
+            Todo &top = todo.back();
+            if (top.next < top.successors.size())
+            {
+                size_t t = top.successors[top.next++];
+                if (!number[t])
+                {
+                    push(t);
+                    if (out_of_budget())
+                        return false;
+                    continue;
+                }
+
+                if (dead[t])
+                    continue;
+
+                // `t` is on the stack, every root above it joins its component
+                std::vector<uint64_t> acc(words, 0);
+                while (roots.back().number > number[t])
+                {
+                    for (size_t w = 0; w < words; w++)
+                        acc[w] |= roots.back().acc[w];
+                    roots.pop_back();
+                }
+
+                for (size_t w = 0; w < words; w++)
+                    roots.back().acc[w] |= acc[w];
+
+                if (all_sets(roots.back().acc))
+                {
+                    counterexample(result);
+                    return true;
+                }
+            }
+            else
+            {
+                size_t s = top.state;
+                todo.pop_back();
+
+                if (roots.back().number == number[s])
+                {
+                    roots.pop_back();
+
+                    size_t x;
+                    do
+                    {
+                        x = live.back();
+                        live.pop_back();
+                        dead[x] = true;
+                    } while (x != s);
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /// Lasso through the accepting component on top of the roots: the path
+    /// of the search down to its root, then a cycle from the root through
+    /// every acceptance set
+    void counterexample(CheckResult &result)
+    {
+        result.holds = false;
+        size_t root_number = roots.back().number;
+
+        std::vector<bool> in_component(kripke_of.size(), false);
+        for (size_t i = live.size(); i-- > 0 && number[live[i]] >= root_number;)
+            in_component[live[i]] = true;
+
+        size_t root = 0;
+        for (const Todo &item : todo)
+        {
+            if (number[item.state] == root_number)
+            {
+                root = item.state;
+                break;
+            }
+            result.prefix.push_back(kripke_of[item.state]);
+        }
+
+        std::vector<uint64_t> covered = acceptance_of(root);
+        std::vector<size_t> cycle = {root};
+        size_t current = root;
+
+        while (!all_sets(covered))
+        {
+            // nearest state which adds a missing set
+            std::vector<size_t> path = shortest_path(current, in_component, [&](size_t s)
+            {
+                std::vector<uint64_t> acc = acceptance_of(s);
+                for (size_t w = 0; w < words; w++)
+                {
+                    if (acc[w] & ~covered[w])
+                        return true;
+                }
+                return false;
+            });
+
+            for (size_t s : path)
+            {
+                std::vector<uint64_t> acc = acceptance_of(s);
+                for (size_t w = 0; w < words; w++)
+                    covered[w] |= acc[w];
+                cycle.push_back(s);
+            }
+            current = path.back();
+        }
+
+        std::vector<size_t> back = shortest_path(current, in_component, [root](size_t s) { return s == root; });
+        back.pop_back();
+        cycle.insert(cycle.end(), back.begin(), back.end());
+
+        for (size_t s : cycle)
+            result.cycle.push_back(kripke_of[s]);
+    }
+
+    /// States after `from` on a shortest nonempty path inside the component
+    /// to a state satisfying `target`, which ends the path
+    template<class F>
+    std::vector<size_t> shortest_path(size_t from, const std::vector<bool> &in_component, F target)
+    {
+        std::unordered_map<size_t, size_t> parent;
+        std::deque<size_t> queue = {from};
+
+        while (!queue.empty())
+        {
+            size_t s = queue.front();
+            queue.pop_front();
+
+            for (size_t t : successors(s))
+            {
+                if (t >= in_component.size() || !in_component[t])
+                    continue;
+
+                if (target(t))
+                {
+                    std::vector<size_t> path = {t};
+                    for (size_t x = s; x != from; x = parent[x])
+                        path.insert(path.begin(), x);
+                    return path;
+                }
+
+                if (t == from || parent.count(t))
+                    continue;
+
+                parent[t] = s;
+                queue.push_back(t);
+            }
+        }
+
+        return {};
+    }
+
+    Translator &translator;
+    const Kripke &kripke;
+
+    size_t sets_count = 0;
+    size_t words = 0;
+    std::vector<std::vector<bool>> values;
+
+    std::unordered_map<uint64_t, size_t> ids;
+    std::vector<size_t> kripke_of;
+    std::vector<size_t> tableau_of;
+    std::vector<size_t> number;     // order of the search, 0 if not reached yet
+    std::vector<bool> dead;         // the component of the state is done
+
+    std::vector<Root> roots;
+    std::vector<size_t> live;
+    std::vector<Todo> todo;
+    size_t visited = 0;
+};
@@ -0,0 +1,406 @@
+#pragma once
+
+#include "ltl.h"
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+struct ParseError
+{
+    size_t position = 0;
+    std::string message;
+};
+
+/// Operator-precedence parser for the usual Spot/LTL2BA syntax. Operands and
+/// pending operators live on explicit stacks, so deeply nested input does not
+/// consume native stack and every token is shifted and reduced once.
+class Parser
+{
+    enum class Token : uint8_t
+    {
+        END,
+        ATOM,
+        TRUE,
+        FALSE,
+        LPAREN,
+        RPAREN,
+        NOT,
+        X,
+        F,
+        G,
+        AND,
+        OR,
+        XOR,
+        IMPL,
+        EQUIV,
+        U,
+        R,
+        W
+    };
+
+    struct Pending
+    {
+        Token token;
+        size_t position;
+    };
+
+    LtlFactory &factory;
+    const char *text;
+    const char *stream;
+    size_t token_start;
+    std::string token_text;
+    std::vector<ref_ptr<Ltl>> operands;
+    std::vector<Pending> operators;
+    ParseError last_error;
+
+public:
+    explicit Parser(LtlFactory &factory) : factory(factory) { }
+
+    /// Returns the parsed formula, or an empty pointer if `s` is malformed;
+    /// the reason is available through error() in that case.
+    ref_ptr<Ltl> parse(const char *s)
+    {
+        text = s;
+        stream = s;
+        operands.clear();
+        operators.clear();
+        last_error = ParseError();
+
+        ref_ptr<Ltl> ltl;
+        if (parse_formula())
+        {
+            ltl = operands.back();
+        }
+
+        operands.clear();
+        operators.clear();
+
+        return ltl;
+    }
+
+    const ParseError &error() const
+    {
+        return last_error;
+    }
+
+private:
+    bool parse_formula()
+    {
+        bool expect_operand = true;
+
+        while (true)
+        {
+            Token token;
+            if (!next_token(token))
+                return false;
+
+            if (expect_operand)
+            {
+                switch (token)
+                {
+                    case Token::ATOM:
+                        operands.push_back(factory.atom(token_text));
+                        expect_operand = false;
+                        break;
+
+                    case Token::TRUE:
+                        operands.push_back(factory.True());
+                        expect_operand = false;
+                        break;
+
+                    case Token::FALSE:
+                        operands.push_back(factory.False());
+                        expect_operand = false;
+                        break;
+
+                    case Token::LPAREN:
+                    case Token::NOT:
+                    case Token::X:
+                    case Token::F:
+                    case Token::G:
+                        operators.push_back({token, token_start});
+                        break;
+
+                    case Token::END:
+                        return fail(token_start, operands.empty() && operators.empty() ? "empty formula" : "unexpected end of formula, operand expected");
+
+                    default:
+                        return fail(token_start, "operand expected");
+                }
+                continue;
+            }
+
+            switch (token)
+            {
+                case Token::RPAREN:
+                    while (!operators.empty() && operators.back().token != Token::LPAREN)
+                        reduce();
+                    if (operators.empty())
+                        return fail(token_start, "unbalanced ')'");
+                    operators.pop_back();
+                    break;
+
+                case Token::END:
+                    while (!operators.empty())
+                    {
+                        if (operators.back().token == Token::LPAREN)
+                            return fail(operators.back().position, "unbalanced '('");
+                        reduce();
+                    }
+                    return true;
+
+                default:
+                {
+                    int prec = precedence(token);
+                    if (prec == 0 || is_unary(token))
+                        return fail(token_start, "binary operator expected");
+
+                    while (!operators.empty() && operators.back().token != Token::LPAREN)
+                    {
+                        int top_prec = precedence(operators.back().token);
+                        if (top_prec < prec || (top_prec == prec && is_right_assoc(token)))
+                            break;
+                        reduce();
+                    }
+                    operators.push_back({token, token_start});
+                    expect_operand = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    void reduce()
+    {
+        Token token = operators.back().token;
+        operators.pop_back();
+
+        ref_ptr<Ltl> rop = pop();
+        if (is_unary(token))
+        {
+            operands.push_back(factory.unary(operator_of(token), rop));
+            return;
+        }
+
+        ref_ptr<Ltl> lop = pop();
+        switch (token)
+        {
+            case Token::EQUIV:
+                operands.push_back(equivalence(lop, rop));
+                break;
+
+            case Token::XOR:
+                operands.push_back(factory.unary(Operator::NOT, equivalence(lop, rop)));
+                break;
+
+            default:
+                operands.push_back(factory.binary(operator_of(token), lop, rop));
+                break;
+        }
+    }
+
+    ref_ptr<Ltl> equivalence(const ref_ptr<Ltl> &lop, const ref_ptr<Ltl> &rop)
+    {
+        return factory.binary(Operator::AND,
+            factory.binary(Operator::IMPL, lop, rop),
+            factory.binary(Operator::IMPL, rop, lop));
+    }
+
+    ref_ptr<Ltl> pop()
+    {
+        ref_ptr<Ltl> ltl = std::move(operands.back());
+        operands.pop_back();
+        return ltl;
+    }
+
+    bool next_token(Token &token)
+    {
+        static const struct
+        {
+            const char *text;
+            Token token;
+        } punctuators[] = {
+            {"<-->", Token::EQUIV},
+            {"<->", Token::EQUIV},
+            {"<=>", Token::EQUIV},
+            {"-->", Token::IMPL},
+            {"->", Token::IMPL},
+            {"=>", Token::IMPL},
+            {"<>", Token::F},
+            {"[]", Token::G},
+            {"&&", Token::AND},
+            {"||", Token::OR},
+            {"/\\", Token::AND},
+            {"\\/", Token::OR},
+            {"&", Token::AND},
+            {"|", Token::OR},
+            {"^", Token::XOR},
+            {"!", Token::NOT},
+            {"~", Token::NOT},
+            {"(", Token::LPAREN},
+            {")", Token::RPAREN}};
+
+        while (*stream && isspace((unsigned char) *stream))
+            ++stream;
+
+        token_start = stream - text;
+        const char c = *stream;
+
+        if (!c)
+        {
+            token = Token::END;
+            return true;
+        }
+
+        for (const auto &item : punctuators)
+        {
+            size_t len = strlen(item.text);
+            if (!strncmp(stream, item.text, len))
+            {
+                stream += len;
+                token = item.token;
+                return true;
+            }
+        }
+
+        if (c == '"')
+            return lex_quoted(token);
+
+        if (c == '0' || c == '1')
+        {
+            ++stream;
+            token = c == '1' ? Token::TRUE : Token::FALSE;
+            return true;
+        }
+
+        if (!isalpha((unsigned char) c) && c != '_')
+            return fail(token_start, "unexpected character");
+
+        // `GFa` is `G F a`, as in Spot: a leading F, G or X of a longer
+        // identifier is an operator applied to the rest of it
+        const char *end = stream + 1;
+        if (c != 'F' && c != 'G' && c != 'X')
+        {
+            while (*end && (isalnum((unsigned char) *end) || *end == '_'))
+                ++end;
+        }
+
+        token_text.assign(stream, end);
+        stream = end;
+
+        if (token_text.size() == 1)
+        {
+            switch (c)
+            {
+                case 'X': token = Token::X; return true;
+                case 'F': token = Token::F; return true;
+                case 'G': token = Token::G; return true;
+                case 'U': token = Token::U; return true;
+                case 'R':
+                case 'V': token = Token::R; return true;
+                case 'W': token = Token::W; return true;
+            }
+        }
+
+        if (token_text == "true")
+            token = Token::TRUE;
+        else if (token_text == "false")
+            token = Token::FALSE;
+        else if (token_text == "xor")
+            token = Token::XOR;
+        else
+            token = Token::ATOM;
+
+        return true;
+    }
+
+    bool lex_quoted(Token &token)
+    {
+        token_text.clear();
+
+        const char *s = stream + 1;
+        while (*s && *s != '"')
+        {
+            if (*s == '\\' && s[1])
+                ++s;
+            token_text.push_back(*s++);
+        }
+
+        if (!*s)
+            return fail(token_start, "unterminated quoted atom");
+        if (token_text.empty())
+            return fail(token_start, "empty quoted atom");
+
+        stream = s + 1;
+        token = Token::ATOM;
+        return true;
+    }
+
+    bool fail(size_t position, const char *message)
+    {
+        last_error.position = position;
+        last_error.message = message;
+        return false;
+    }
+
+    static bool is_unary(Token token)
+    {
+        return token == Token::NOT || token == Token::X || token == Token::F || token == Token::G;
+    }
+
+    static bool is_right_assoc(Token token)
+    {
+        return token == Token::IMPL || token == Token::EQUIV ||
+            token == Token::U || token == Token::R || token == Token::W;
+    }
+
+    // Same relative binding strength as Spot: `->`/`<->` < `|` < `xor` < `&` < `U`/`R`/`W` < unary
+    static int precedence(Token token)
+    {
+        switch (token)
+        {
+            case Token::IMPL:
+            case Token::EQUIV:
+                return 1;
+            case Token::OR:
+                return 2;
+            case Token::XOR:
+                return 3;
+            case Token::AND:
+                return 4;
+            case Token::U:
+            case Token::R:
+            case Token::W:
+                return 5;
+            case Token::NOT:
+            case Token::X:
+            case Token::F:
+            case Token::G:
+                return 6;
+            default:
+                return 0;
+        }
+    }
+
+    static Operator operator_of(Token token)
+    {
+        switch (token)
+        {
+            case Token::NOT: return Operator::NOT;
+            case Token::X: return Operator::X;
+            case Token::F: return Operator::F;
+            case Token::G: return Operator::G;
+            case Token::AND: return Operator::AND;
+            case Token::OR: return Operator::OR;
+            case Token::IMPL: return Operator::IMPL;
+            case Token::U: return Operator::U;
+            case Token::R: return Operator::R;
+            case Token::W: return Operator::W;
+            default: return Operator::FALSE;
+        }
+    }
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+extern char **environ;
+
+/// Outcome of compiling one report
+struct PdfResult
+{
+    enum Status
+    {
+        COMPILED,
+        NOT_FOUND,      // pdflatex could not be started
+        FAILED
+    };
+
+    size_t index;           // order of submission
+    Status status;
+    std::string tex_name;   // removed once it is compiled
+    std::string pdf_name;
+    std::string log_name;   // kept in the temporary directory of a failed job
+};
+
+/// Compiles LaTeX reports with pdflatex in child processes, at most
+/// `max_jobs` at a time, while the caller goes on translating. Every job runs
+/// in a temporary directory of its own, so concurrent jobs never share their
+/// auxiliary files. Children are reaped with waitpid(-1), so the process
+/// should have no other children while jobs are running.
+class PdfPool
+{
+public:
+    explicit PdfPool(size_t max_jobs) : max_jobs(max_jobs ? max_jobs : 1) { }
+
+    PdfPool(const PdfPool &) = delete;
+    PdfPool &operator=(const PdfPool &) = delete;
+
+    ~PdfPool()
+    {
+        wait();
+    }
+
+    /// Starts compiling `tex_name` into `pdf_name`, first waiting for a free
+    /// slot if all of them are taken
+    void submit(const std::string &tex_name, const std::string &pdf_name)
+    {
+        while (running.size() >= max_jobs)
+            reap_one();
+
+        Job job;
+        job.result = {submitted++, PdfResult::FAILED, tex_name, pdf_name, ""};
+
+        const char *tmp = getenv("TMPDIR");
+        std::string dir_template = std::string(tmp && *tmp ? tmp : "/tmp") + "/buchi-XXXXXX";
+        if (!mkdtemp(&dir_template[0]))
+        {
+            finished.push_back(job.result);
+            return;
+        }
+        job.dir = dir_template;
+
+        std::string base = tex_name.substr(tex_name.rfind('/') + 1);
+        job.stem = base.substr(0, base.rfind('.'));
+        job.result.log_name = job.dir + "/" + job.stem + ".log";
+
+        std::string output_dir = "-output-directory=" + job.dir;
+        std::string console = job.dir + "/pdflatex.out";
+        char *args[] = {(char*) "pdflatex", (char*) "-interaction=nonstopmode", (char*) "-halt-on-error",
+                        &output_dir[0], (char*) tex_name.c_str(), nullptr};
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, console.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+        int error = posix_spawnp(&job.pid, "pdflatex", &actions, nullptr, args, environ);
+        posix_spawn_file_actions_destroy(&actions);
+
+        if (error)
+        {
+            job.result.status = PdfResult::NOT_FOUND;
+            remove_dir(job.dir);
+            finished.push_back(job.result);
+            return;
+        }
+
+        running.push_back(job);
+    }
+
+    /// Waits for every job and returns the results of all jobs finished
+    /// since the last call, in the order they were submitted
+    std::vector<PdfResult> wait()
+    {
+        while (!running.empty())
+            reap_one();
+
+        std::vector<PdfResult> results;
+        results.swap(finished);
+        std::sort(results.begin(), results.end(), [](const PdfResult &a, const PdfResult &b)
+        {
+            return a.index < b.index;
+        });
+
+        return results;
+    }
+
+private:
+    struct Job
+    {
+        pid_t pid;
+        std::string dir;
+        std::string stem;
+        PdfResult result;
+    };
+
+    void reap_one()
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            // nothing left to wait for, the children are gone
+            for (Job &job : running)
+                finished.push_back(job.result);
+            running.clear();
+            return;
+        }
+
+        auto it = std::find_if(running.begin(), running.end(), [pid](const Job &job) { return job.pid == pid; });
+        if (it == running.end())
+            return;
+
+        Job job = *it;
+        running.erase(it);
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && move_file(job.dir + "/" + job.stem + ".pdf", job.result.pdf_name))
+        {
+            job.result.status = PdfResult::COMPILED;
+            job.result.log_name.clear();
+            remove_dir(job.dir);
+            remove(job.result.tex_name.c_str());
+        }
+
+        finished.push_back(job.result);
+    }
+
+    /// Renames `from`, copying it if the temporary directory is on another
+    /// file system
+    static bool move_file(const std::string &from, const std::string &to)
+    {
+        if (!rename(from.c_str(), to.c_str()))
+            return true;
+
+        if (errno != EXDEV)
+            return false;
+
+        FILE *src = fopen(from.c_str(), "rb");
+        if (!src)
+            return false;
+
+        FILE *dst = fopen(to.c_str(), "wb");
+        if (!dst)
+        {
+            fclose(src);
+            return false;
+        }
+
+        char buffer[1 << 16];
+        size_t read;
+        bool ok = true;
+        while ((read = fread(buffer, 1, sizeof(buffer), src)) > 0)
+            ok = ok && fwrite(buffer, 1, read, dst) == read;
+
+        fclose(src);
+        ok = !fclose(dst) && ok;
+        remove(from.c_str());
+
+        return ok;
+    }
+
+    static void remove_dir(const std::string &dir)
+    {
+        if (DIR *d = opendir(dir.c_str()))
+        {
+            while (dirent *entry = readdir(d))
+            {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..")
+                    remove((dir + "/" + name).c_str());
+            }
+            closedir(d);
+        }
+
+        rmdir(dir.c_str());
+    }
+
+    size_t max_jobs;
+    size_t submitted = 0;
+    std::vector<Job> running;
+    std::vector<PdfResult> finished;
+};
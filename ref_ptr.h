@@ -1,6 +1,66 @@
 #ifndef BUCHI_REFPTR_H
 #define BUCHI_REFPTR_H
 
+#include <atomic>
+
+/// Counts references with a plain integer; objects must stay in one thread
+struct plain_refcount {
+    using counter_type = int;
+
+    static void increment(counter_type &n) {
+        ++n;
+    }
+
+    /// Returns true when the last reference is dropped
+    static bool decrement(counter_type &n) {
+        return --n == 0;
+    }
+};
+
+/// Counts references atomically, so objects can be shared between threads.
+/// A new reference is always made from an existing one, so the increment
+/// needs no ordering; the last decrement acquires the writes of the other
+/// owners before the object is destroyed.
+struct atomic_refcount {
+    using counter_type = std::atomic<int>;
+
+    static void increment(counter_type &n) {
+        n.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool decrement(counter_type &n) {
+        return n.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+};
+
+/// Intrusive counter for the objects ref_ptr points to, following `Policy`.
+/// An immortal counter is never touched: such objects live in static storage
+/// and are shared without any refcount traffic.
+template<typename Policy>
+class ref_count {
+public:
+    explicit ref_count(bool immortal = false) : immortal(immortal) {
+    }
+
+    ref_count(const ref_count &) = delete;
+    ref_count &operator=(const ref_count &) = delete;
+
+    void increment() {
+        if (!immortal) {
+            Policy::increment(n);
+        }
+    }
+
+    /// Returns true when the last reference is dropped
+    bool decrement() {
+        return !immortal && Policy::decrement(n);
+    }
+
+private:
+    typename Policy::counter_type n{0};
+    const bool immortal;
+};
+
 template<typename T>
 class ref_ptr {
 public:
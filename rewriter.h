@@ -0,0 +1,177 @@
+#pragma once
+
+#include "ltl.h"
+
+#include <unordered_map>
+#include <vector>
+
+/// Rewrites a formula into the core the tableau works with in a single
+/// bottom-up pass. Nodes are never modified in place: new ones are built
+/// through the Ltl factory and results are memoized per input node, so shared
+/// subformulas stay shared and are rewritten once.
+class Rewriter
+{
+public:
+    enum Rule : unsigned
+    {
+        PUSH_X = 1 << 0,    // X a ∘ b => X a ∘ X b, X ∘ a => ∘ X a
+        R_TO_U = 1 << 1,    // a R b => !(!a U !b)
+        W_TO_U = 1 << 2,    // a W b => (a U b) | G a
+        G_TO_F = 1 << 3,    // G a => !F !a
+        F_TO_U = 1 << 4,    // F a => true U a
+        ALL_RULES = PUSH_X | R_TO_U | W_TO_U | G_TO_F | F_TO_U
+    };
+
+    explicit Rewriter(LtlFactory &factory, unsigned rules = ALL_RULES) : factory(factory), rules(rules) { }
+
+    /// Forgets the memoized results, keeping the tables' storage for reuse
+    void clear()
+    {
+        rewritten.clear();
+        nexted.clear();
+    }
+
+    /// Returns `ltl` itself if none of the enabled rules applies anywhere
+    ref_ptr<Ltl> rewrite(const ref_ptr<Ltl> &ltl)
+    {
+        return transform(ltl.get(), rewritten, [](const Ltl *) { return true; }, [this](Ltl *ltl)
+        {
+            if (!ltl->lhs())
+                return ref_ptr<Ltl>(ltl);
+
+            const ref_ptr<Ltl> &lop = rewritten[ltl->lhs()];
+            const ref_ptr<Ltl> &rop = ltl->rhs() ? rewritten[ltl->rhs()] : ltl->rop;
+
+            if (lop.get() == ltl->lhs() && rop.get() == ltl->rhs() && !applies_to(ltl))
+                return ref_ptr<Ltl>(ltl);
+
+            return build(ltl->kind(), lop, rop);
+        });
+    }
+
+private:
+    using memo_type = std::unordered_map<const Ltl*, ref_ptr<Ltl>>;
+
+    bool applies(Operator opc) const
+    {
+        switch (opc)
+        {
+            case Operator::X: return rules & PUSH_X;
+            case Operator::R: return rules & R_TO_U;
+            case Operator::W: return rules & W_TO_U;
+            case Operator::G: return rules & G_TO_F;
+            case Operator::F: return rules & F_TO_U;
+            default: return false;
+        }
+    }
+
+    bool applies_to(const Ltl *ltl) const
+    {
+        if (ltl->kind() == Operator::X)
+            return applies(Operator::X) && ltl->lhs()->kind() != Operator::ATOM && ltl->lhs()->kind() != Operator::X;
+        return applies(ltl->kind());
+    }
+
+    /// Builds `opc` over already rewritten operands, applying the enabled rules
+    ref_ptr<Ltl> build(Operator opc, const ref_ptr<Ltl> &lop, const ref_ptr<Ltl> &rop)
+    {
+        if (applies(opc))
+        {
+            switch (opc)
+            {
+                case Operator::X:
+                    return push_X(lop);
+
+                case Operator::R:
+                    return factory.unary(Operator::NOT, factory.binary(Operator::U, factory.unary(Operator::NOT, lop), factory.unary(Operator::NOT, rop)));
+
+                case Operator::W:
+                    return factory.binary(Operator::OR, factory.binary(Operator::U, lop, rop), build(Operator::G, lop, nullptr));
+
+                case Operator::G:
+                    return factory.unary(Operator::NOT, build(Operator::F, factory.unary(Operator::NOT, lop), nullptr));
+
+                case Operator::F:
+                    return factory.binary(Operator::U, factory.True(), lop);
+
+                default:
+                    break;
+            }
+        }
+
+        return rop ? factory.binary(opc, lop, rop) : factory.unary(opc, lop);
+    }
+
+    /// X over an already rewritten formula, moved down to the atoms and Xs
+    ref_ptr<Ltl> push_X(const ref_ptr<Ltl> &ltl)
+    {
+        return transform(ltl.get(), nexted, [](const Ltl *ltl)
+        {
+            return ltl->kind() != Operator::ATOM && ltl->kind() != Operator::X;
+        }, [this](Ltl *ltl)
+        {
+            switch (ltl->kind())
+            {
+                case Operator::TRUE:
+                case Operator::FALSE:
+                    return ref_ptr<Ltl>(ltl);
+
+                case Operator::ATOM:
+                case Operator::X:
+                    return factory.unary(Operator::X, ltl);
+
+                default:
+                    return build(ltl->kind(), nexted[ltl->lhs()], ltl->rhs() ? nexted[ltl->rhs()] : nullptr);
+            }
+        });
+    }
+
+    /// Memoized post-order walk over the DAG rooted at `root`: `combine` is
+    /// called once per distinct node whose children `descend` allowed to visit
+    template<class Descend, class Combine>
+    static ref_ptr<Ltl> transform(Ltl *root, memo_type &memo, Descend &&descend, Combine &&combine)
+    {
+        struct Frame
+        {
+            Ltl *ltl;
+            bool expanded;
+        };
+
+        std::vector<Frame> stack = {{root, false}};
+
+        while (!stack.empty())
+        {
+            Ltl *ltl = stack.back().ltl;
+
+            if (stack.back().expanded)
+            {
+                stack.pop_back();
+                if (memo.find(ltl) == memo.end())
+                    memo.emplace(ltl, combine(ltl));
+                continue;
+            }
+
+            if (memo.find(ltl) != memo.end())
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            stack.back().expanded = true;
+            if (descend(ltl))
+            {
+                if (ltl->rhs())
+                    stack.push_back({ltl->rop.get(), false});
+                if (ltl->lhs())
+                    stack.push_back({ltl->lop.get(), false});
+            }
+        }
+
+        return memo[root];
+    }
+
+    LtlFactory &factory;
+    unsigned rules;
+    memo_type rewritten;
+    memo_type nexted;
+};
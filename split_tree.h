@@ -1,49 +1,89 @@
 #pragma once
 
-#include <memory>
+#include <cstddef>
 
+#include <utility>
+#include <vector>
+
+template<class DATA>
+class NodePool;
+
+/// Node of a binary tree stored in a NodePool. Children are indices in the
+/// same pool and the subtree metrics are computed once, when the node is
+/// added over its already added children.
 template<class DATA>
 class Node
 {
 public:
+    static constexpr int NONE = -1;
+
     DATA data;
-    std::shared_ptr<Node> first = nullptr;
-    std::shared_ptr<Node> second = nullptr;
+    int first = NONE;
+    int second = NONE;
 
-    Node(DATA data) : data(data) { }
+    int nodes_count() const { return nodes; }
+    int leafs_count() const { return leafs; }
+    int depth() const { return tree_depth; }
 
-    std::shared_ptr<Node> set_first(std::shared_ptr<Node> ref) { first = ref; return first; }
-    std::shared_ptr<Node> set_first(DATA value) { first = new Node(value); return first; }
+private:
+    friend class NodePool<DATA>;
 
-    std::shared_ptr<Node> set_second(std::shared_ptr<Node> ref) { second = ref; return first; }
-    std::shared_ptr<Node> set_second(DATA value) { second = new Node(value); return first; }
+    Node(DATA data) : data(std::move(data)) { }
 
-    int nodes_count() const {
-        int res = 1;
-        if (first.get())
-            res += first->nodes_count();
-        if (second.get())
-            res += second->nodes_count();
+    int nodes = 1;
+    int leafs = 1;
+    int tree_depth = 1;
+};
+
+/// Contiguous storage for any number of trees, built bottom-up
+template<class DATA>
+class NodePool
+{
+public:
+    using node_type = Node<DATA>;
 
-        return res;
+    void clear()
+    {
+        nodes.clear();
     }
 
-    int leafs_count() const {
-        int res = (!first.get() && !second.get()) ? 1 : 0;
-        if (first.get())
-            res += first->leafs_count();
-        if (second.get())
-            res += second->leafs_count();
+    /// Adds a node over the subtrees `first` and `second` (or a leaf) and
+    /// returns its index
+    int add(DATA data, int first = node_type::NONE, int second = node_type::NONE)
+    {
+        node_type node(std::move(data));
+        node.first = first;
+        node.second = second;
 
-        return res;
-    }
+        if (first != node_type::NONE || second != node_type::NONE)
+        {
+            node.leafs = 0;
+            for (int child : {first, second})
+            {
+                if (child == node_type::NONE)
+                    continue;
 
-    int depth() const {
-        int first_depth = first.get() ? first->depth() + 1 : 0;
-        int second_depth = second.get() ? second->depth() + 1 : 0;
+                node.nodes += nodes[child].nodes;
+                node.leafs += nodes[child].leafs;
+                if (nodes[child].tree_depth + 1 > node.tree_depth)
+                    node.tree_depth = nodes[child].tree_depth + 1;
+            }
+        }
 
-        int max_depth = first_depth > second_depth ? first_depth : second_depth;
+        nodes.push_back(std::move(node));
+        return nodes.size() - 1;
+    }
 
-        return max_depth > 1 ? max_depth : 1;
+    const node_type &operator[](int node) const
+    {
+        return nodes[node];
     }
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+private:
+    std::vector<node_type> nodes;
 };
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "translator.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+using stats_clock = std::chrono::steady_clock;
+
+enum Phase
+{
+    PARSE,
+    REWRITE,
+    CLOSURE,
+    STATES,
+    FINALIZE,       // marking of the initial states and the accepting sets
+    TRANSITIONS,    // check_edge_rules over every pair of states
+    OUTPUT,
+    PHASES_COUNT
+};
+
+static const char *PHASE_NAMES[PHASES_COUNT] = {"parse", "rewrite", "closure", "states", "finalize", "transitions", "output"};
+
+/// Phase times and counters of one translation
+struct Stats
+{
+    double micros[PHASES_COUNT] = { };
+
+    size_t closure = 0;
+    size_t splits = 0;          // UNKNOWN untils split by add_state
+    size_t states = 0;
+    size_t edge_checks = 0;
+    size_t edges = 0;
+    size_t allocations = 0;     // filled in by the caller, only counted with BUCHI_COUNT_ALLOCATIONS
+    Resource exceeded = Resource::NONE;
+
+    /// One JSON object on one line
+    void write_json(FILE *dst, const char *formula) const
+    {
+        fprintf(dst, "{\"formula\": \"");
+        for (const char *c = formula; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                fputc('\\', dst);
+            fputc(*c, dst);
+        }
+        fprintf(dst, "\"");
+
+        double total = 0;
+        for (int phase = 0; phase < PHASES_COUNT; phase++)
+        {
+            fprintf(dst, ", \"%s_us\": %.1f", PHASE_NAMES[phase], micros[phase]);
+            total += micros[phase];
+        }
+
+        fprintf(dst, ", \"total_us\": %.1f, \"closure\": %zu, \"splits\": %zu, \"states\": %zu, "
+                     "\"edge_checks\": %zu, \"edges\": %zu, \"allocations\": %zu, \"exceeded\": \"%s\"}\n",
+                total, closure, splits, states, edge_checks, edges, allocations, RESOURCE_NAMES[(int) exceeded]);
+    }
+};
+
+/// Report policy which measures the phases of Translator::translate and
+/// counts its work, forwarding every hook to `Inner`. The time spent in the
+/// hooks of `Inner` is counted as OUTPUT. Plain translations never see this
+/// class, so the counters cost nothing unless it is asked for.
+template<class Inner = NoReport>
+class StatsReport : public Inner
+{
+public:
+    using Inner::Inner;
+
+    Stats stats;
+
+    /// Phases outside of translate(), such as PARSE and OUTPUT
+    void begin(Phase) { mark = stats_clock::now(); }
+    void end(Phase phase) { lap(phase); }
+
+    void on_formula(const ref_ptr<Ltl> &ltl)
+    {
+        mark = stats_clock::now();
+        Inner::on_formula(ltl);
+        lap(OUTPUT);
+    }
+
+    void on_rewritten(const ref_ptr<Ltl> &ltl)
+    {
+        lap(REWRITE);
+        Inner::on_rewritten(ltl);
+        lap(OUTPUT);
+    }
+
+    void on_closure(const std::vector<const Ltl*> &atoms, const std::vector<const Ltl*> &all)
+    {
+        lap(CLOSURE);
+        stats.closure = all.size();
+        Inner::on_closure(atoms, all);
+        lap(OUTPUT);
+    }
+
+    void on_split()
+    {
+        stats.splits++;
+        Inner::on_split();
+    }
+
+    void on_valuation(const std::vector<bool> &mask, const SplitTrees &trees, int tree)
+    {
+        paused(STATES, [&] { Inner::on_valuation(mask, trees, tree); });
+    }
+
+    void on_states(const StateTable &states)
+    {
+        lap(STATES);
+        stats.states = states.size();
+        Inner::on_states(states);
+        lap(OUTPUT);
+    }
+
+    void on_initial_begin()
+    {
+        paused(FINALIZE, [&] { Inner::on_initial_begin(); });
+    }
+
+    void on_initial(size_t i)
+    {
+        paused(FINALIZE, [&] { Inner::on_initial(i); });
+    }
+
+    void on_initial_end()
+    {
+        paused(FINALIZE, [&] { Inner::on_initial_end(); });
+    }
+
+    void on_accepting_begin()
+    {
+        paused(FINALIZE, [&] { Inner::on_accepting_begin(); });
+    }
+
+    void on_accepting_set(const Ltl *l, const Ltl *right)
+    {
+        paused(FINALIZE, [&] { Inner::on_accepting_set(l, right); });
+    }
+
+    void on_accepting(size_t i)
+    {
+        paused(FINALIZE, [&] { Inner::on_accepting(i); });
+    }
+
+    void on_accepting_set_end()
+    {
+        paused(FINALIZE, [&] { Inner::on_accepting_set_end(); });
+    }
+
+    void on_transitions_begin()
+    {
+        in_transitions = true;
+        lap(FINALIZE);
+        Inner::on_transitions_begin();
+        lap(OUTPUT);
+    }
+
+    void on_successors_begin(size_t from)
+    {
+        paused(TRANSITIONS, [&] { Inner::on_successors_begin(from); });
+    }
+
+    void on_edge_check()
+    {
+        stats.edge_checks++;
+        Inner::on_edge_check();
+    }
+
+    void on_successor(size_t to)
+    {
+        stats.edges++;
+        paused(TRANSITIONS, [&] { Inner::on_successor(to); });
+    }
+
+    void on_successors_end()
+    {
+        paused(TRANSITIONS, [&] { Inner::on_successors_end(); });
+    }
+
+    void on_end()
+    {
+        lap(TRANSITIONS);
+        Inner::on_end();
+        lap(OUTPUT);
+    }
+
+    /// The counters keep the partial work of the stopped translation
+    void on_exceeded(const BudgetStatus &status)
+    {
+        lap(in_transitions ? TRANSITIONS : STATES);
+        stats.exceeded = status.exceeded;
+        stats.states = status.states;
+        Inner::on_exceeded(status);
+        lap(OUTPUT);
+    }
+
+private:
+    void lap(Phase phase)
+    {
+        auto now = stats_clock::now();
+        stats.micros[phase] += std::chrono::duration<double, std::micro>(now - mark).count();
+        mark = now;
+    }
+
+    /// Runs a hook of `Inner` inside `phase`, counting its own time as
+    /// OUTPUT; hooks of NoReport are empty, so there is nothing to count
+    template<class F>
+    void paused(Phase phase, F hook)
+    {
+        if (!Inner::enabled)
+            return hook();
+
+        lap(phase);
+        hook();
+        lap(OUTPUT);
+    }
+
+    stats_clock::time_point mark = stats_clock::now();
+    bool in_transitions = false;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "automaton.h"
+#include "ltl.h"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/// X is the only operator which tells a word from its stuttered versions, so
+/// a formula without it has a stutter-invariant language. The check is
+/// syntactic: some formulas with X are stutter-invariant too.
+inline bool is_stutter_invariant(const Ltl *ltl)
+{
+    bool invariant = true;
+    Ltl::for_each_postorder(ltl, [&](const Ltl *node)
+    {
+        if (node->kind() == Operator::X)
+            invariant = false;
+    });
+    return invariant;
+}
+
+/// Automaton of the same language as `maton`, which must be stutter-invariant,
+/// closed under stuttering and with its chain states removed. `letters` gives
+/// every state a class, the states of one class read the same letters.
+/// `origin`, if given, receives the state of `maton` every state comes from.
+///
+/// Every state which is not in all the accepting sets gets a self-loop: no
+/// accepting run stays in it forever, so the loop only repeats letters. Then
+/// a state is bypassed if all its other successors read its letter, loop and
+/// are in every accepting set it is in; its predecessors go to them directly
+/// and read the letter one time less.
+inline std::unique_ptr<Automaton> reduce_stuttering(const Automaton &maton, const std::vector<size_t> &letters, std::vector<size_t> *origin = nullptr)
+{
+    size_t card = maton.card();
+
+    std::vector<std::vector<size_t>> sets_of(card);
+    for (size_t set = 0; set < maton.accept_sets_count(); set++)
+    {
+        for (size_t state : maton.accepting_set(set))
+            sets_of[state].push_back(set);
+    }
+    for (std::vector<size_t> &sets : sets_of)
+    {
+        std::sort(sets.begin(), sets.end());
+        sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+    }
+
+    std::vector<std::vector<size_t>> successors(card);
+    std::vector<std::vector<size_t>> predecessors(card);
+    for (size_t state = 0; state < card; state++)
+    {
+        Successors next = maton.successors(state);
+        successors[state].assign(next.begin(), next.end());
+        if (sets_of[state].size() < maton.accept_sets_count())
+            successors[state].push_back(state);
+
+        std::sort(successors[state].begin(), successors[state].end());
+        successors[state].erase(std::unique(successors[state].begin(), successors[state].end()), successors[state].end());
+
+        for (size_t to : successors[state])
+            predecessors[to].push_back(state);
+    }
+
+    std::vector<bool> initial(card, false);
+    for (size_t state : maton.initial_states())
+        initial[state] = true;
+
+    auto loops = [&](size_t state)
+    {
+        return std::binary_search(successors[state].begin(), successors[state].end(), state);
+    };
+
+    std::vector<bool> removed(card, false);
+    std::vector<size_t> pending;
+    for (size_t state = card; state-- > 0;)
+        pending.push_back(state);
+
+    while (!pending.empty())
+    {
+        size_t state = pending.back();
+        pending.pop_back();
+        if (removed[state])
+            continue;
+
+        std::vector<size_t> targets;
+        bool bypassed = true;
+        for (size_t to : successors[state])
+        {
+            if (to == state)
+                continue;
+
+            bypassed = bypassed && letters[to] == letters[state] && loops(to) &&
+                       std::includes(sets_of[to].begin(), sets_of[to].end(), sets_of[state].begin(), sets_of[state].end());
+            targets.push_back(to);
+        }
+
+        if (!bypassed || targets.empty())
+            continue;
+
+        removed[state] = true;
+        for (size_t from : predecessors[state])
+        {
+            std::vector<size_t> &next = successors[from];
+            auto edge = std::lower_bound(next.begin(), next.end(), state);
+            if (from == state || removed[from] || edge == next.end() || *edge != state)
+                continue;
+
+            next.erase(edge);
+
+            std::vector<size_t> merged;
+            std::set_union(next.begin(), next.end(), targets.begin(), targets.end(), std::back_inserter(merged));
+            next.swap(merged);
+
+            for (size_t to : targets)
+                predecessors[to].push_back(from);
+
+            // the predecessor may now be a chain state itself
+            pending.push_back(from);
+        }
+
+        if (initial[state])
+        {
+            for (size_t to : targets)
+                initial[to] = true;
+        }
+    }
+
+    std::vector<size_t> index(card);
+    size_t kept = 0;
+    for (size_t state = 0; state < card; state++)
+    {
+        if (!removed[state])
+            index[state] = kept++;
+    }
+
+    std::unique_ptr<Automaton> reduced(new Automaton(kept));
+    reduced->reserve_accept_sets(maton.accept_sets_count());
+    reduced->mark_stutter_invariant();
+    if (origin)
+        origin->clear();
+
+    for (size_t state = 0; state < card; state++)
+    {
+        if (removed[state])
+            continue;
+
+        for (size_t to : successors[state])
+        {
+            if (!removed[to])
+                reduced->add_transition(index[state], index[to]);
+        }
+
+        if (initial[state])
+            reduced->mark_init(index[state]);
+
+        for (size_t set : sets_of[state])
+            reduced->mark_accept(set, index[state]);
+
+        if (!maton.label(state).empty())
+            reduced->set_label(index[state], maton.label(state));
+
+        if (origin)
+            origin->push_back(state);
+    }
+
+    return reduced;
+}
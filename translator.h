@@ -0,0 +1,1347 @@
+#pragma once
+
+#include "automaton.h"
+#include "external.h"
+#include "ltl.h"
+#include "parser.h"
+#include "rewriter.h"
+#include "split_tree.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Split trees of add_state, one per atom valuation, with the masks of the
+/// closure at every split
+using SplitTrees = NodePool<std::vector<Status>>;
+
+/// Consistent states of the tableau, stored row after row in one buffer so
+/// that the storage can be reused from one translation to the next
+class StateTable
+{
+public:
+    void reset(size_t row_width)
+    {
+        cells.clear();
+        width = row_width;
+    }
+
+    void push_back(const std::vector<Status> &state)
+    {
+        cells.insert(cells.end(), state.begin(), state.end());
+    }
+
+    const Status *operator[](size_t state) const
+    {
+        return cells.data() + state * width;
+    }
+
+    size_t size() const
+    {
+        return width ? cells.size() / width : 0;
+    }
+
+    void push_back(const Status *state)
+    {
+        cells.insert(cells.end(), state, state + width);
+    }
+
+    void swap(StateTable &other)
+    {
+        cells.swap(other.cells);
+        std::swap(width, other.width);
+    }
+
+    size_t bytes() const
+    {
+        return cells.size() * sizeof(Status);
+    }
+
+private:
+    std::vector<Status> cells;
+    size_t width = 0;
+};
+
+enum class Resource
+{
+    NONE,
+    TIME,
+    STATES,
+    EDGES,
+    BYTES,
+    ATOMS       // more atoms than a valuation rank has bits
+};
+
+static const char *RESOURCE_NAMES[] = {"none", "time", "states", "edges", "bytes", "atoms"};
+
+/// Progress of the last translation and the limit it was stopped by, if any
+struct BudgetStatus
+{
+    Resource exceeded = Resource::NONE;
+    double seconds = 0;
+    size_t states = 0;
+    size_t edges = 0;
+    size_t bytes = 0;
+};
+
+/// Limits of one translation, zero means unlimited. They are checked as the
+/// states are found and between the rows of transitions, so the work done
+/// past a limit is at most one row.
+struct Budget
+{
+    double seconds = 0;
+    size_t states = 0;
+    size_t edges = 0;
+    size_t bytes = 0;       // estimate of the state table and the adjacency lists
+
+    /// Marks in `status` the first limit its progress is past, if any; every
+    /// engine fills in its own counters and leaves the comparison to this
+    bool exceeded_by(BudgetStatus &status) const
+    {
+        if (seconds > 0 && status.seconds > seconds)
+            status.exceeded = Resource::TIME;
+        else if (states && status.states > states)
+            status.exceeded = Resource::STATES;
+        else if (edges && status.edges > edges)
+            status.exceeded = Resource::EDGES;
+        else if (bytes && status.bytes > bytes)
+            status.exceeded = Resource::BYTES;
+
+        return status.exceeded != Resource::NONE;
+    }
+};
+
+/// Size of an automaton, counted by Translator::count without building it
+struct AutomatonCounts
+{
+    size_t states = 0;
+    size_t initial = 0;
+    std::vector<size_t> accepting;      // states in every acceptance set
+    size_t edges = 0;
+};
+
+/// Report policy of Translator::translate which records nothing. Every hook
+/// is an empty inline function and no split trees are built, so the plain
+/// construction carries no reporting code or allocations at all.
+struct NoReport
+{
+    static constexpr bool enabled = false;
+    static constexpr bool split_tree = false;
+
+    void on_formula(const ref_ptr<Ltl> &) { }
+    void on_rewritten(const ref_ptr<Ltl> &) { }
+    void on_closure(const std::vector<const Ltl*> &, const std::vector<const Ltl*> &) { }
+    void on_split() { }
+    void on_valuation(const std::vector<bool> &, const SplitTrees &, int) { }
+    void on_states(const StateTable &) { }
+    void on_initial_begin() { }
+    void on_initial(size_t) { }
+    void on_initial_end() { }
+    void on_accepting_begin() { }
+    void on_accepting_set(const Ltl *, const Ltl *) { }
+    void on_accepting(size_t) { }
+    void on_accepting_set_end() { }
+    void on_transitions_begin() { }
+    void on_successors_begin(size_t) { }
+    void on_edge_check() { }
+    void on_successor(size_t) { }
+    void on_successors_end() { }
+    void on_end() { }
+    void on_exceeded(const BudgetStatus &) { }
+};
+
+/// Translates LTL formulas into Büchi automata by the tableau construction.
+/// An instance owns its formula factory, parser, rewriter memo and scratch
+/// buffers and reuses them from call to call. It is not synchronized:
+/// concurrent translations need one instance per thread, and instances share
+/// no mutable state.
+class Translator
+{
+public:
+    struct Options
+    {
+        bool reversed_mask = false;     // enumerate atom valuations flipping the first atom fastest
+        bool compress = false;          // store every row of successors delta and varint encoded
+        Budget budget;
+    };
+
+    Translator() : Translator(Options()) { }
+
+    explicit Translator(Options options)
+        : options(options), parser(ltl_factory), rewriter(ltl_factory) { }
+
+    Translator(const Translator &) = delete;
+    Translator &operator=(const Translator &) = delete;
+
+    LtlFactory &factory()
+    {
+        return ltl_factory;
+    }
+
+    /// Returns an empty pointer if `text` is malformed, see error()
+    ref_ptr<Ltl> parse(const char *text)
+    {
+        return parser.parse(text);
+    }
+
+    const ParseError &error() const
+    {
+        return parser.error();
+    }
+
+    /// Tells why the last translate() returned an empty pointer for a
+    /// well-formed formula, and how far it got
+    const BudgetStatus &budget_status() const
+    {
+        return status;
+    }
+
+    /// The formula in the U/X core the tableau is built from
+    ref_ptr<Ltl> rewrite(const ref_ptr<Ltl> &ltl)
+    {
+        ref_ptr<Ltl> rewritten = rewriter.rewrite(ltl);
+        rewriter.clear();
+        return rewritten;
+    }
+
+    /// Returns an empty pointer if `text` is malformed, see error()
+    std::unique_ptr<Automaton> translate(const char *text)
+    {
+        NoReport report;
+        return translate(text, report);
+    }
+
+    std::unique_ptr<Automaton> translate(const ref_ptr<Ltl> &ltl)
+    {
+        NoReport report;
+        return translate(ltl, report);
+    }
+
+    template<class Report>
+    std::unique_ptr<Automaton> translate(const char *text, Report &report)
+    {
+        ref_ptr<Ltl> ltl = parse(text);
+        if (!ltl)
+            return nullptr;
+
+        return translate(ltl, report);
+    }
+
+    /// Builds the automaton for `formula`, reporting every step of the
+    /// construction to `report` (NoReport or LatexReport). Returns an empty
+    /// pointer if the budget of the options is exceeded, see budget_status().
+    template<class Report>
+    std::unique_ptr<Automaton> translate(const ref_ptr<Ltl> &formula, Report &report)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+
+        report.on_formula(formula);
+
+        // kept like the one of build_tableau, tableau_atoms() point into it
+        tableau_formula = rewrite(formula);
+        report.on_rewritten(tableau_formula);
+
+        if (!build_states(tableau_formula, report))
+            return nullptr;
+
+        report.on_states(states);
+
+        std::unique_ptr<Automaton> maton(new Automaton(states.size()));
+
+        report.on_initial_begin();
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            if (is_initial(i))
+            {
+                maton->mark_init(i);
+                report.on_initial(i);
+            }
+        }
+        report.on_initial_end();
+
+        report.on_accepting_begin();
+
+        for (size_t set_no = 0; set_no < acceptance.size(); set_no++)
+        {
+            const AcceptanceSet &set = acceptance[set_no];
+            report.on_accepting_set(set.until, set.right);
+
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                if (is_accepting(set_no, i))
+                {
+                    maton->mark_accept(set_no, i);
+                    report.on_accepting(i);
+                }
+            }
+
+            report.on_accepting_set_end();
+        }
+
+        report.on_transitions_begin();
+
+        size_t edges = 0;
+        if (!build_transitions(*maton, report, edges) || exceeds_budget(edges))
+        {
+            report.on_exceeded(status);
+            return nullptr;
+        }
+
+        report.on_end();
+
+        return maton;
+    }
+
+    /// Builds the automata of several formulas from one tableau over the
+    /// union of their closures, so that its states and transitions are
+    /// enumerated once for the whole family. The automaton of a formula
+    /// starts in the states where it holds, keeps the acceptance sets of its
+    /// own untils, and is made of the states reachable from there projected
+    /// on its closure, so its states only fix the atoms of that formula.
+    /// Returns an empty vector if the budget is exceeded, see budget_status().
+    std::vector<std::unique_ptr<Automaton>> translate_family(const std::vector<ref_ptr<Ltl>> &formulas)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+
+        std::vector<std::unique_ptr<Automaton>> automata;
+        if (formulas.empty())
+            return automata;
+
+        // the conjunction only gathers the closures, whether it holds does not matter
+        ref_ptr<Ltl> family = formulas[0];
+        for (size_t i = 1; i < formulas.size(); i++)
+            family = ltl_factory.binary(Operator::AND, family, formulas[i]);
+
+        tableau_formula = rewrite(family);
+
+        NoReport report;
+        if (!build_states(tableau_formula, report))
+            return automata;
+
+        Automaton shared(states.size());
+        size_t edges = 0;
+        if (!build_transitions(shared, report, edges) || exceeds_budget(edges))
+            return automata;
+
+        // closure_ids knows the nodes by address, so every rewritten formula
+        // stays alive until all of them are projected
+        std::vector<ref_ptr<Ltl>> rewritten;
+        for (const ref_ptr<Ltl> &formula : formulas)
+            rewritten.push_back(rewrite(formula));
+
+        for (const ref_ptr<Ltl> &formula : rewritten)
+            automata.push_back(project(shared, formula.get()));
+
+        return automata;
+    }
+
+    /// Builds the automaton of `formula` like translate() and writes it to `f`
+    /// in the binary format of Automaton::write_binary_to, without holding
+    /// its transitions in memory: they go to sorted runs of at most
+    /// `run_edges` edges in the directory `scratch`, which are then merged.
+    /// Returns false if the budget is exceeded, see budget_status(), or if a
+    /// run or `f` can not be written, see external_error().
+    bool translate_to_file(const ref_ptr<Ltl> &formula, FILE *f, const std::string &scratch, size_t run_edges = size_t(1) << 22)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+        external_message.clear();
+
+        tableau_formula = rewrite(formula);
+
+        NoReport report;
+        if (!build_states(tableau_formula, report))
+            return false;
+
+        AutomatonWriter writer(states.size(), acceptance.size(), scratch, run_edges);
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            if (is_initial(i))
+                writer.mark_init(i);
+        }
+
+        for (size_t set_no = 0; set_no < acceptance.size(); set_no++)
+        {
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                if (is_accepting(set_no, i))
+                    writer.mark_accept(set_no, i);
+            }
+        }
+
+        size_t edges = 0;
+        if (!build_transitions(writer, report, edges) || exceeds_budget(edges))
+            return false;
+
+        if (!writer.write_to(f))
+        {
+            external_message = writer.error();
+            return false;
+        }
+        return true;
+    }
+
+    /// Tells why the last translate_to_file() failed when the budget was not
+    /// exceeded, empty otherwise
+    const std::string &external_error() const
+    {
+        return external_message;
+    }
+
+    /// Counts the states, initial and accepting states and transitions of
+    /// the automaton of `formula` into `counts`, without storing any
+    /// transition. Returns false if the budget is exceeded, see
+    /// budget_status().
+    bool count(const ref_ptr<Ltl> &formula, AutomatonCounts &counts)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+
+        tableau_formula = rewrite(formula);
+
+        NoReport report;
+        if (!build_states(tableau_formula, report))
+            return false;
+
+        counts = AutomatonCounts();
+        counts.states = states.size();
+        counts.accepting.assign(acceptance.size(), 0);
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            counts.initial += is_initial(i);
+            for (size_t set_no = 0; set_no < acceptance.size(); set_no++)
+                counts.accepting[set_no] += is_accepting(set_no, i);
+        }
+
+        return count_transitions(counts.edges) && !exceeds_budget(counts.edges);
+    }
+
+    /// Prepares the tableau of `formula` to be explored on the fly through
+    /// the accessors below: only its closure is built, the states of a
+    /// valuation are added by for_each_state_with the first time they are
+    /// asked for and no transitions are ever built. Returns false if the
+    /// formula has too many atoms; a budget exceeded later on shows in
+    /// budget_status().
+    bool build_tableau(const ref_ptr<Ltl> &formula)
+    {
+        status = BudgetStatus();
+        start = std::chrono::steady_clock::now();
+
+        // the closure points into the formula, which is kept until the next call
+        tableau_formula = rewrite(formula);
+
+        NoReport report;
+        on_demand = true;
+        return prepare_states(tableau_formula, report);
+    }
+
+    /// Atoms of the last tableau, X subformulas among them
+    const std::vector<const Ltl*> &tableau_atoms() const
+    {
+        return atoms;
+    }
+
+    /// Rank of the atom valuation of every state of the last automaton, the
+    /// states of one rank read the same letters if there are no X atoms
+    std::vector<size_t> state_letters() const
+    {
+        std::vector<size_t> letters(states.size(), 0);
+        for (size_t state = 0; state < states.size(); state++)
+        {
+            for (size_t i = 0; i < atoms.size(); i++)
+            {
+                if (states[state][atom_indices[i]] == Status::TRUE)
+                    letters[state] |= size_t(1) << rank_bit(i);
+            }
+        }
+        return letters;
+    }
+
+    /// Value of atom `i` of tableau_atoms() in `state`
+    bool atom_value(size_t state, size_t i) const
+    {
+        return states[state][atom_indices[i]] == Status::TRUE;
+    }
+
+    size_t tableau_size() const
+    {
+        return states.size();
+    }
+
+    bool is_initial(size_t state) const
+    {
+        return states[state][all.size() - 1] == Status::TRUE;
+    }
+
+    size_t acceptance_sets_count() const
+    {
+        return acceptance.size();
+    }
+
+    /// A state is in the set of `p U q` if it satisfies `q` or not `p U q`
+    bool is_accepting(size_t set, size_t state) const
+    {
+        return states[state][acceptance[set].idx] == states[state][acceptance[set].rhs_idx];
+    }
+
+    bool has_transition(size_t from, size_t to) const
+    {
+        return check_edge_rules(from, to);
+    }
+
+    /// Calls `visit(state)` for every state whose atoms have the values of
+    /// `values`, indexed like tableau_atoms(); X subformulas take any value.
+    /// The states of a tableau from build_tableau are built here, and the
+    /// states past an exceeded budget are missing.
+    template<class F>
+    void for_each_state_with(const std::vector<bool> &values, F visit)
+    {
+        size_t fixed = 0;
+        size_t free = 0;
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            size_t bit = size_t(1) << rank_bit(i);
+            if (atoms[i]->kind() == Operator::X)
+                free |= bit;
+            else if (values[i])
+                fixed |= bit;
+        }
+
+        // every subset of the free bits, the empty one last
+        size_t subset = 0;
+        do
+        {
+            if (const ValuationRows *rows = rows_of(fixed | subset))
+            {
+                for (size_t state = rows->first; state < rows->first + rows->count; state++)
+                    visit(state);
+            }
+
+            subset = (subset - free) & free;
+        } while (subset);
+    }
+
+private:
+    static constexpr size_t MAX_ATOMS = 64;
+
+    /// States of one valuation, which come out one after the other
+    struct ValuationRows
+    {
+        size_t rank;
+        size_t first;
+        size_t count;
+    };
+
+    struct ClosureNode
+    {
+        Operator kind;
+        int lhs_idx;
+        int rhs_idx;
+    };
+
+    /// Acceptance condition of one until, the closure indices of the until
+    /// and of the subformula it waits for
+    struct AcceptanceSet
+    {
+        const Ltl *until;
+        const Ltl *right;
+        int idx;
+        int rhs_idx;
+    };
+
+    /// Closure indices one U or X subformula of the closure constrains
+    /// transitions with; an X rule only uses `idx` and `lhs_idx`
+    struct EdgeRule
+    {
+        Operator kind;
+        int idx;
+        int lhs_idx;
+        int rhs_idx;
+    };
+
+    /// Reports the successors `state` shares with the first state of its
+    /// signature; an AutomatonWriter can not read them back and only goes
+    /// with NoReport
+    template<class Report>
+    static void report_successors(const Automaton &maton, size_t state, Report &report)
+    {
+        for (size_t to : maton.successors(state))
+            report.on_successor(to);
+    }
+
+    static void report_successors(const AutomatonWriter &, size_t, NoReport &) { }
+
+    /// Finds the closure and every state of the tableau of the rewritten
+    /// `ltl`, returns false if the budget is exceeded
+    template<class Report>
+    bool build_states(const ref_ptr<Ltl> &ltl, Report &report)
+    {
+        on_demand = false;
+        if (!prepare_states(ltl, report))
+            return false;
+
+        // Valuations are evaluated 64 at a time, bit-sliced: bit `lane` of
+        // the slices holds the closure under the valuation of rank
+        // `block + lane`, the valuation read as a binary number with the
+        // last atom (or the first one, with reversed_mask) as the lowest bit.
+        // The states then come out in the order of rank, and only the ranks
+        // with states are kept, so the rows take no memory per valuation.
+        size_t valuations = size_t(1) << atoms.size();
+        for (size_t block = 0; block < valuations; block += 64)
+        {
+            evaluate_slices(block);
+
+            size_t lanes = std::min<size_t>(64, valuations - block);
+            for (size_t lane = 0; lane < lanes; lane++)
+            {
+                load_lane(lane);
+
+                size_t rank = block + lane;
+                size_t first_row = states.size();
+                int split_tree = add_state(all_mask, report);
+                if (status.exceeded != Resource::NONE)
+                {
+                    report.on_exceeded(status);
+                    return false;
+                }
+
+                if (states.size() > first_row)
+                    valuation_rows.push_back({rank, first_row, states.size() - first_row});
+
+                for (size_t i = 0; i < atoms.size(); i++)
+                    atoms_mask[i] = (rank >> rank_bit(i)) & 1;
+
+                report.on_valuation(atoms_mask, split_trees, split_tree);
+            }
+        }
+
+        return true;
+    }
+
+    /// Finds the closure of the rewritten `ltl` and clears the states,
+    /// returns false if it has too many atoms
+    template<class Report>
+    bool prepare_states(const ref_ptr<Ltl> &ltl, Report &report)
+    {
+        atoms.clear();
+        all.clear();
+        split_trees.clear();
+        stored_bytes = 0;
+
+        get_atoms(ltl.get(), atoms);
+
+        // a valuation is ranked by a size_t with one bit per atom
+        if (atoms.size() >= MAX_ATOMS)
+        {
+            status.exceeded = Resource::ATOMS;
+            report.on_exceeded(status);
+            return false;
+        }
+
+        get_all(ltl.get(), all);
+        closure_ids.clear();
+        closure_index.clear();
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            size_t id = closure_ids.id_of(all[i]);
+            if (id >= closure_index.size())
+                closure_index.resize(id + 1, -1);
+            closure_index[id] = (int) i;
+        }
+
+        states.reset(all.size());
+        build_closure();
+        build_edge_rules();
+
+        report.on_closure(atoms, all);
+
+        valuation_rows.clear();
+        slices.resize(all.size());
+        all_mask.resize(all.size());
+        atoms_mask.resize(atoms.size());
+
+        return true;
+    }
+
+    /// Closure statuses of lane `lane` of the slices into `all_mask`
+    void load_lane(size_t lane)
+    {
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            if (!((slices[i].known >> lane) & 1))
+                all_mask[i] = Status::UNKNOWN;
+            else
+                all_mask[i] = (slices[i].value >> lane) & 1 ? Status::TRUE : Status::FALSE;
+        }
+    }
+
+    /// States of the valuation of rank `rank`, nullptr if it has none. On
+    /// demand they are built the first time, and a valuation without states
+    /// keeps empty rows so that it is not tried again; nullptr also means
+    /// that the budget was exceeded then.
+    const ValuationRows *rows_of(size_t rank)
+    {
+        auto rows = std::lower_bound(valuation_rows.begin(), valuation_rows.end(), rank,
+                                     [](const ValuationRows &rows, size_t rank) { return rows.rank < rank; });
+        if (rows != valuation_rows.end() && rows->rank == rank)
+            return &*rows;
+        if (!on_demand)
+            return nullptr;
+
+        evaluate_slices(rank & ~size_t(63));
+        load_lane(rank & 63);
+
+        NoReport report;
+        size_t first_row = states.size();
+        add_state(all_mask, report);
+        if (status.exceeded != Resource::NONE)
+            return nullptr;
+
+        return &*valuation_rows.insert(rows, {rank, first_row, states.size() - first_row});
+    }
+
+    /// Bit of the rank atom `i` takes its value from
+    size_t rank_bit(size_t i) const
+    {
+        return options.reversed_mask ? i : atoms.size() - 1 - i;
+    }
+
+    /// Evaluates the closure into `slices` under the 64 valuations of ranks
+    /// `block` to `block + 63`; the closure is in post-order, so the
+    /// operands of every subformula are done before it
+    void evaluate_slices(size_t block)
+    {
+        // lanes where each of the low six bits of the rank is set
+        static constexpr uint64_t LANE_BITS[6] = {
+            0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+            0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull};
+
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            size_t bit = rank_bit(i);
+            uint64_t value = bit < 6 ? LANE_BITS[bit] : (block >> bit) & 1 ? ~uint64_t(0) : 0;
+            slices[atom_indices[i]] = {~uint64_t(0), value};
+        }
+
+        const StatusSlice unknown = {0, 0};
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            const ClosureNode &node = closure_nodes[i];
+            if (node.kind == Operator::ATOM || node.kind == Operator::X)
+                continue;
+
+            slices[i] = Ltl::evaluate(node.kind,
+                                      node.lhs_idx >= 0 ? slices[node.lhs_idx] : unknown,
+                                      node.rhs_idx >= 0 ? slices[node.rhs_idx] : unknown);
+        }
+    }
+
+    /// Adds the states consistent with the evaluated `all_mask`; returns the
+    /// index of the split tree in `split_trees` if the report asks for one.
+    ///
+    /// The UNKNOWN untils are the decisions of a depth-first search, taken
+    /// in closure order from `from` on, FALSE first. Each decision is
+    /// propagated to its dependents, which are recorded on `trail` and
+    /// reset on backtracking, so `all_mask` is shared by the whole search
+    /// and comes back unchanged.
+    template<class Report>
+    int add_state(std::vector<Status> &all_mask, Report &report, size_t from = 0)
+    {
+        constexpr bool SPLIT_TREE = Report::split_tree;
+
+        if (status.exceeded != Resource::NONE)
+            return SplitTrees::node_type::NONE;
+
+        // every subformula before `from` is known
+        size_t unknown_until_idx = from;
+        while (unknown_until_idx < all.size() && all_mask[unknown_until_idx] != Status::UNKNOWN)
+            unknown_until_idx++;
+
+        if (unknown_until_idx < all.size())
+        {
+            report.on_split();
+
+            int first = decide(all_mask, unknown_until_idx, Status::FALSE, report);
+            int second = decide(all_mask, unknown_until_idx, Status::TRUE, report);
+
+            if (SPLIT_TREE)
+                return split_trees.add(all_mask, first, second);
+        }
+
+        else
+        {
+            states.push_back(all_mask);
+            exceeds_budget(0);
+
+            if (SPLIT_TREE)
+                return split_trees.add(all_mask);
+        }
+
+        return SplitTrees::node_type::NONE;
+    }
+
+    /// Sets the until `idx` to `value`, adds the states below the decision
+    /// and takes it back
+    template<class Report>
+    int decide(std::vector<Status> &all_mask, size_t idx, Status value, Report &report)
+    {
+        size_t mark = trail.size();
+
+        all_mask[idx] = value;
+        for (int dependent : dependents[idx])
+        {
+            if (all_mask[dependent] != Status::UNKNOWN)
+                continue;
+
+            evaluate(all_mask, dependent);
+            if (all_mask[dependent] != Status::UNKNOWN)
+                trail.push_back(dependent);
+        }
+
+        int tree = add_state(all_mask, report, idx + 1);
+
+        while (trail.size() > mark)
+        {
+            all_mask[trail.back()] = Status::UNKNOWN;
+            trail.pop_back();
+        }
+        all_mask[idx] = Status::UNKNOWN;
+
+        return tree;
+    }
+
+    /// Operator and closure indices of the operands of every subformula of
+    /// the closure, the subformulas depending on each one and the closure
+    /// indices of the atoms. The closure is in post-order, so operands and
+    /// dependents come before and after a subformula.
+    void build_closure()
+    {
+        closure_nodes.clear();
+        atom_indices.clear();
+        dependents.assign(all.size(), std::vector<int>());
+
+        for (auto a : all)
+        {
+            int lhs_idx = a->lhs() ? find_in_closure(a->lhs()) : -1;
+            int rhs_idx = a->rhs() ? find_in_closure(a->rhs()) : -1;
+            closure_nodes.push_back({a->kind(), lhs_idx, rhs_idx});
+        }
+
+        for (auto atom : atoms)
+            atom_indices.push_back(find_in_closure(atom));
+
+        acceptance.clear();
+        for (auto l : all)
+        {
+            if (l->kind() == Operator::U ||
+                l->kind() == Operator::F ||
+                l->kind() == Operator::G ||
+                l->kind() == Operator::R ||
+                l->kind() == Operator::W)
+            {
+                auto right = (l->kind() == Operator::F || l->kind() == Operator::G) ? l->lhs() : l->rhs();
+                acceptance.push_back({l, right, find_in_closure(l), find_in_closure(right)});
+            }
+        }
+
+        std::vector<bool> seen(all.size());
+        for (size_t i = all.size(); i-- > 0;)
+        {
+            std::fill(seen.begin(), seen.end(), false);
+            for (size_t parent = i + 1; parent < all.size(); parent++)
+            {
+                const ClosureNode &node = closure_nodes[parent];
+                if (node.kind == Operator::X || (node.lhs_idx != (int) i && node.rhs_idx != (int) i))
+                    continue;
+
+                seen[parent] = true;
+                for (int dependent : dependents[parent])
+                    seen[dependent] = true;
+            }
+
+            for (size_t j = i + 1; j < all.size(); j++)
+            {
+                if (seen[j])
+                    dependents[i].push_back(j);
+            }
+        }
+    }
+
+    /// Index in the closure of the subformula equal to `ltl`, -1 if none
+    int find_in_closure(const Ltl *ltl)
+    {
+        size_t id = closure_ids.id_of(ltl);
+        return id < closure_index.size() ? closure_index[id] : -1;
+    }
+
+    /// Calculates the status of subformula `i` if it is still unknown
+    void evaluate(std::vector<Status> &all_mask, int i) const
+    {
+        if (all_mask[i] != Status::UNKNOWN)
+            return;
+
+        const ClosureNode &node = closure_nodes[i];
+        all_mask[i] = Ltl::evaluate(node.kind,
+                                    node.lhs_idx >= 0 ? all_mask[node.lhs_idx] : Status::UNKNOWN,
+                                    node.rhs_idx >= 0 ? all_mask[node.rhs_idx] : Status::UNKNOWN);
+    }
+
+    /// Automaton of `formula`, whose closure is part of the last tableau, out
+    /// of the transitions of the tableau in `shared`. Tableau states which
+    /// agree on the closure of `formula` become one state.
+    std::unique_ptr<Automaton> project(const Automaton &shared, const Ltl *formula)
+    {
+        std::vector<const Ltl*> closure;
+        get_all(formula, closure);
+
+        std::vector<int> indices;
+        for (const Ltl *subformula : closure)
+            indices.push_back(find_in_closure(subformula));
+        int root = indices.back();
+
+        std::vector<bool> in_formula(all.size());
+        for (int index : indices)
+        {
+            assert(index >= 0 && "the closure of a formula is part of the tableau");
+            in_formula[index] = true;
+        }
+
+        std::vector<size_t> sets;
+        for (size_t set = 0; set < acceptance.size(); set++)
+        {
+            if (in_formula[acceptance[set].idx])
+                sets.push_back(set);
+        }
+
+        const size_t NONE = SIZE_MAX;
+        std::vector<size_t> projected(states.size(), NONE);
+        std::vector<size_t> representatives;    // a tableau state of every projected one
+        std::map<std::vector<Status>, size_t> ids;
+        std::vector<size_t> pending;
+
+        auto reach = [&](size_t state)
+        {
+            if (projected[state] != NONE)
+                return projected[state];
+
+            std::vector<Status> key;
+            for (int i : indices)
+                key.push_back(states[state][i]);
+
+            auto it = ids.emplace(std::move(key), representatives.size()).first;
+            if (it->second == representatives.size())
+                representatives.push_back(state);
+
+            pending.push_back(state);
+            return projected[state] = it->second;
+        };
+
+        std::vector<size_t> initial;
+        for (size_t state = 0; state < states.size(); state++)
+        {
+            if (states[state][root] == Status::TRUE)
+                initial.push_back(reach(state));
+        }
+
+        std::vector<std::pair<size_t, size_t>> transitions;
+        while (!pending.empty())
+        {
+            size_t state = pending.back();
+            pending.pop_back();
+
+            for (size_t to : shared.successors(state))
+                transitions.push_back({projected[state], reach(to)});
+        }
+
+        std::unique_ptr<Automaton> maton(new Automaton(representatives.size()));
+        maton->reserve_accept_sets(sets.size());
+
+        for (size_t state : initial)
+            maton->mark_init(state);
+
+        for (const std::pair<size_t, size_t> &transition : transitions)
+            maton->add_transition(transition.first, transition.second);
+
+        for (size_t set = 0; set < sets.size(); set++)
+        {
+            for (size_t state = 0; state < representatives.size(); state++)
+            {
+                if (is_accepting(sets[set], representatives[state]))
+                    maton->mark_accept(set, state);
+            }
+        }
+
+        maton->finalize();
+        return maton;
+    }
+
+    /// Every state packed into WORDS 64-bit words, bit `i` set if closure
+    /// formula `i` holds; empty for WORDS == 0
+    template<size_t WORDS>
+    std::vector<std::array<uint64_t, WORDS>> state_bits() const
+    {
+        std::vector<std::array<uint64_t, WORDS>> bits(WORDS ? states.size() : 0);
+        for (size_t state = 0; state < bits.size(); state++)
+        {
+            bits[state].fill(0);
+            for (size_t i = 0; i < all.size(); i++)
+            {
+                if (states[state][i] == Status::TRUE)
+                    bits[state][i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+        return bits;
+    }
+
+    /// Counts the transitions of every state with the kernel build_transitions
+    /// would use; returns false if the budget is exceeded
+    bool count_transitions(size_t &edges)
+    {
+        if (all.size() <= 64)
+            return count_transitions<1>(edges);
+        if (all.size() <= 128)
+            return count_transitions<2>(edges);
+        if (all.size() <= 256)
+            return count_transitions<4>(edges);
+        return count_transitions<0>(edges);
+    }
+
+    /// Counts the successors of every state without listing them. With
+    /// WORDS > 0 the successors of a state are the states which have the
+    /// bits of `value` under its mask `care`, so the states are counted once
+    /// by their bits under every mask that occurs, and a state looks its
+    /// count up. WORDS == 0 checks the rules once for every signature.
+    template<size_t WORDS>
+    bool count_transitions(size_t &edges)
+    {
+        using Bits = std::array<uint64_t, WORDS>;
+
+        std::vector<Bits> bits = state_bits<WORDS>();
+        std::map<Bits, std::map<Bits, size_t>> count_under;
+        std::map<std::vector<uint64_t>, size_t> count_of;
+        std::vector<uint64_t> signature;
+
+        for (size_t from = 0; from < states.size(); from++)
+        {
+            if (exceeds_budget(edges))
+                return false;
+
+            Bits care, value;
+            if (WORDS > 0)
+            {
+                if (!successor_mask(from, care, value))
+                    continue;
+
+                auto counts = count_under.find(care);
+                if (counts == count_under.end())
+                {
+                    counts = count_under.emplace(care, std::map<Bits, size_t>()).first;
+                    for (const Bits &to : bits)
+                    {
+                        Bits key;
+                        for (size_t w = 0; w < WORDS; w++)
+                            key[w] = to[w] & care[w];
+                        counts->second[key]++;
+                    }
+                    stored_bytes += counts->second.size() * (sizeof(Bits) + sizeof(size_t));
+                }
+
+                auto count = counts->second.find(value);
+                if (count != counts->second.end())
+                    edges += count->second;
+                continue;
+            }
+
+            edge_signature(from, signature);
+            auto count = count_of.find(signature);
+            if (count == count_of.end())
+            {
+                count = count_of.emplace(signature, 0).first;
+                for (size_t to = 0; to < states.size(); to++)
+                {
+                    if (check_edge_rules(from, to))
+                        count->second++;
+                }
+            }
+            edges += count->second;
+        }
+
+        return true;
+    }
+
+    /// Adds the transitions of every state to `maton`, an Automaton or an
+    /// AutomatonWriter, with the smallest kernel the closure fits in, the
+    /// generic one past 256; returns false if the budget is exceeded
+    template<class Target, class Report>
+    bool build_transitions(Target &maton, Report &report, size_t &edges)
+    {
+        if (all.size() <= 64)
+            return add_transitions<1>(maton, report, edges);
+        if (all.size() <= 128)
+            return add_transitions<2>(maton, report, edges);
+        if (all.size() <= 256)
+            return add_transitions<4>(maton, report, edges);
+        return add_transitions<0>(maton, report, edges);
+    }
+
+    /// Updates the progress in `status` and marks the limit that is reached
+    /// first; every state is counted with an empty adjacency list and only
+    /// the stored rows count as edge memory
+    bool exceeds_budget(size_t edges)
+    {
+        status.states = states.size();
+        status.edges = edges;
+        status.bytes = states.bytes() + states.size() * (sizeof(std::vector<size_t>) + 2 * sizeof(size_t)) +
+                       valuation_rows.size() * sizeof(ValuationRows) + stored_bytes;
+
+        status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return options.budget.exceeded_by(status);
+    }
+
+    /// Adds the transitions of every state, returns false if the budget is
+    /// exceeded. With WORDS > 0 every state is packed into WORDS 64-bit
+    /// words, and the edge rules of a source state become one mask of the
+    /// bits its successors must have, so checking a pair takes WORDS
+    /// compares. WORDS == 0 checks the rules one by one.
+    template<size_t WORDS, class Target, class Report>
+    bool add_transitions(Target &maton, Report &report, size_t &edges)
+    {
+        using Bits = std::array<uint64_t, WORDS>;
+
+        std::vector<Bits> bits = state_bits<WORDS>();
+
+        // The successors of a state only depend on its signature, the bits
+        // the edge rules read from it: the first state of every signature
+        // checks its successors and the others share its row. The map keeps
+        // the first state and its number of successors.
+        std::map<std::vector<uint64_t>, std::pair<size_t, size_t>> first_of;
+        std::vector<uint64_t> signature;
+        stored_bytes = 0;
+
+        for (size_t from = 0; from < states.size(); from++)
+        {
+            if (exceeds_budget(edges))
+                return false;
+
+            report.on_successors_begin(from);
+
+            Bits care, value;
+            if (WORDS == 0)
+                edge_signature(from, signature);
+            else if (successor_mask(from, care, value))
+            {
+                signature.assign(care.begin(), care.end());
+                signature.insert(signature.end(), value.begin(), value.end());
+            }
+            else
+            {
+                report.on_successors_end();
+                continue;
+            }
+
+            auto first = first_of.find(signature);
+            if (first != first_of.end())
+            {
+                maton.share_successors(from, first->second.first);
+                report_successors(maton, from, report);
+                edges += first->second.second;
+
+                report.on_successors_end();
+                continue;
+            }
+
+            first = first_of.emplace(signature, std::make_pair(from, size_t(0))).first;
+            size_t edges_before = edges;
+
+            if (WORDS == 0)
+            {
+                for (size_t to = 0; to < states.size(); to++)
+                {
+                    report.on_edge_check();
+                    if (check_edge_rules(from, to))
+                    {
+                        maton.add_transition(from, to);
+                        report.on_successor(to);
+                        edges++;
+                    }
+                }
+            }
+
+            else
+            {
+                for (size_t to = 0; to < states.size(); to++)
+                {
+                    report.on_edge_check();
+
+                    uint64_t mismatch = 0;
+                    for (size_t w = 0; w < WORDS; w++)
+                        mismatch |= (bits[to][w] ^ value[w]) & care[w];
+
+                    if (!mismatch)
+                    {
+                        maton.add_transition(from, to);
+                        report.on_successor(to);
+                        edges++;
+                    }
+                }
+            }
+
+            first->second.second = edges - edges_before;
+            if (options.compress)
+                maton.compress_successors(from);
+            stored_bytes += maton.successors_bytes(from);
+            report.on_successors_end();
+        }
+
+        return true;
+    }
+
+    /// Statuses of `from` which check_edge_rules reads, in the order of the
+    /// rules
+    void edge_signature(size_t from, std::vector<uint64_t> &signature) const
+    {
+        const Status *src = states[from];
+
+        signature.clear();
+        for (const EdgeRule &rule : edge_rules)
+        {
+            signature.push_back((uint64_t) src[rule.idx]);
+            if (rule.kind == Operator::U)
+            {
+                signature.push_back((uint64_t) src[rule.lhs_idx]);
+                signature.push_back((uint64_t) src[rule.rhs_idx]);
+            }
+        }
+    }
+
+    /// The bits of `care` every successor of `from` must have as in `value`,
+    /// by the same rules as check_edge_rules; false if `from` has no
+    /// successors at all
+    template<size_t WORDS>
+    bool successor_mask(const size_t from, std::array<uint64_t, WORDS> &care, std::array<uint64_t, WORDS> &value) const
+    {
+        const Status *src = states[from];
+
+        care.fill(0);
+        value.fill(0);
+
+        for (const EdgeRule &rule : edge_rules)
+        {
+            int bit;
+            bool required;
+
+            if (rule.kind == Operator::U)
+            {
+                if ((src[rule.idx] == Status::TRUE && src[rule.rhs_idx] == Status::TRUE) ||
+                    (src[rule.idx] == Status::FALSE && src[rule.lhs_idx] == Status::FALSE && src[rule.rhs_idx] == Status::FALSE))
+                    continue;
+
+                if (!(src[rule.lhs_idx] == Status::TRUE && src[rule.rhs_idx] == Status::FALSE))
+                    return false;
+
+                bit = rule.idx;
+                required = src[rule.idx] == Status::TRUE;
+            }
+            else
+            {
+                bit = rule.lhs_idx;
+                required = src[rule.idx] == Status::TRUE;
+            }
+
+            uint64_t mask = uint64_t(1) << (bit % 64);
+            if ((care[bit / 64] & mask) && bool(value[bit / 64] & mask) != required)
+                return false;
+
+            care[bit / 64] |= mask;
+            if (required)
+                value[bit / 64] |= mask;
+        }
+
+        return true;
+    }
+
+    void build_edge_rules()
+    {
+        edge_rules.clear();
+
+        for (auto a : all)
+        {
+            if (a->kind() == Operator::U)
+                edge_rules.push_back({Operator::U, find_in_closure(a), find_in_closure(a->lhs()), find_in_closure(a->rhs())});
+            else if (a->kind() == Operator::X)
+                edge_rules.push_back({Operator::X, find_in_closure(a), find_in_closure(a->lhs()), -1});
+        }
+    }
+
+    bool check_edge_rules(const size_t from, const size_t to) const
+    {
+        const Status *src = states[from];
+        const Status *dst = states[to];
+
+        for (const EdgeRule &rule : edge_rules)
+        {
+            if (rule.kind == Operator::U)
+            {
+                if (!(
+                    (src[rule.idx] == Status::TRUE && src[rule.rhs_idx] == Status::TRUE) ||  // p U q === true, q === true -> any succesor possible
+                    (src[rule.idx] == Status::FALSE && src[rule.lhs_idx] == Status::FALSE && src[rule.rhs_idx] == Status::FALSE) ||  // if p U q === false, and p, q === 0 -> any succesor possible
+                    (src[rule.lhs_idx] == Status::TRUE && src[rule.rhs_idx] == Status::FALSE && src[rule.idx] == dst[rule.idx])  // if p === 1, q === 0 -> successor must have p U q same as prdecessor
+                ))
+                    return false;
+            }
+            else
+            {
+                if (!(
+                    src[rule.idx] == dst[rule.lhs_idx]
+                ))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    Options options;
+    LtlFactory ltl_factory;
+    Parser parser;
+    Rewriter rewriter;
+
+    // scratch buffers, reused by every translation
+    std::vector<const Ltl*> atoms;
+    std::vector<const Ltl*> all;
+    StructuralIds closure_ids;
+    std::vector<int> closure_index;  // index in `all` by structural id, -1 if none
+    std::vector<bool> atoms_mask;
+    std::vector<Status> all_mask;
+    std::vector<int> trail;         // subformulas decided by the propagation of add_state
+    std::vector<EdgeRule> edge_rules;
+    StateTable states;
+    SplitTrees split_trees;
+    std::vector<ClosureNode> closure_nodes;
+    std::vector<std::vector<int>> dependents;
+    std::vector<int> atom_indices;
+    std::vector<AcceptanceSet> acceptance;
+    std::vector<StatusSlice> slices;
+    std::vector<ValuationRows> valuation_rows;              // by rank, only those with states or tried on demand
+    bool on_demand = false;                                 // states are built by rows_of, see build_tableau
+    size_t stored_bytes = 0;                                // memory of the rows of the automaton
+    std::string external_message;                            // error of translate_to_file
+
+    ref_ptr<Ltl> tableau_formula;
+
+    BudgetStatus status;
+    std::chrono::steady_clock::time_point start;
+};